@@ -0,0 +1,318 @@
+#include "microbus.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Synchronous trigger with 1/8/64 subscribers
+
+    void BM_TriggerTopic(benchmark::State& state) {
+        microbus::event_bus bus;
+        auto topic = bus.topic<int>("OnValue");
+        int64_t sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            bus.subscribe(topic, [&sum](int value) { sum += value; });
+        }
+        for (auto _ : state) {
+            bus.trigger(topic, 1);
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_TriggerTopic)->Arg(1)->Arg(8)->Arg(64);
+
+    void BM_TriggerString(benchmark::State& state) {
+        microbus::event_bus bus;
+        int64_t sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            bus.subscribe("OnValue", (microbus::event_bus::event_handler<int>)[&sum](int value) { sum += value; });
+        }
+        const std::string name = "OnValue";
+        for (auto _ : state) {
+            bus.trigger(name, 1);
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_TriggerString)->Arg(1)->Arg(8)->Arg(64);
+
+    struct on_value : microbus::static_topic<int> {};
+
+    void BM_TriggerStatic(benchmark::State& state) {
+        microbus::static_event_bus<on_value> bus;
+        int64_t sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            bus.subscribe<on_value>([&sum](int value) { sum += value; });
+        }
+        for (auto _ : state) {
+            bus.trigger<on_value>(1);
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_TriggerStatic)->Arg(1)->Arg(8)->Arg(64);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // String key overhead against the number of interned topics
+
+    void BM_StringKeyTopics(benchmark::State& state) {
+        microbus::event_bus bus;
+        int64_t sum = 0;
+        std::vector<std::string> names;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            names.push_back("orders.region" + std::to_string(i) + ".filled");
+            bus.subscribe(names.back(), (microbus::event_bus::event_handler<int>)[&sum](int value) { sum += value; });
+        }
+        std::size_t next = 0;
+        for (auto _ : state) {
+            bus.trigger(names[next], 1);
+            next = next + 1 == names.size() ? 0 : next + 1;
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_StringKeyTopics)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Asynchronous enqueue with 1-16 producers
+
+    std::shared_ptr<microbus::event_bus> enqueue_bus;
+    std::unique_ptr<microbus::event_loop> enqueue_loop;
+    microbus::topic_handle<int> enqueue_topic;
+    std::atomic<int64_t> enqueue_sum{0};
+
+    void BM_EnqueueProducers(benchmark::State& state) {
+        if (state.thread_index() == 0) {
+            enqueue_bus = std::make_shared<microbus::event_bus>();
+            enqueue_topic = enqueue_bus->topic<int>("OnValue");
+            enqueue_bus->subscribe(enqueue_topic, [](int value) { enqueue_sum.fetch_add(value, std::memory_order_relaxed); });
+            enqueue_loop = std::make_unique<microbus::event_loop>(microbus::event_loop_options{1 << 16, microbus::overflow_policy::block});
+        }
+        for (auto _ : state) {
+            enqueue_loop->enqueue_event(enqueue_bus, enqueue_topic, 1);
+        }
+        if (state.thread_index() == 0) {
+            enqueue_loop->wait_until_finished();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_EnqueueProducers)->ThreadRange(1, 16)->UseRealTime();
+
+    void BM_EnqueueBatch(benchmark::State& state) {
+        auto bus = std::make_shared<microbus::event_bus>();
+        auto topic = bus->topic<int>("OnValue");
+        std::atomic<int64_t> sum{0};
+        bus->subscribe(topic, [&sum](int value) { sum.fetch_add(value, std::memory_order_relaxed); });
+        microbus::event_loop loop(microbus::event_loop_options{1 << 16, microbus::overflow_policy::block});
+        std::vector<int> values(static_cast<std::size_t>(state.range(0)), 1);
+        for (auto _ : state) {
+            loop.enqueue_batch(bus, topic, values);
+        }
+        loop.wait_until_finished();
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_EnqueueBatch)->Arg(1)->Arg(16)->Arg(256)->UseRealTime();
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // drop_oldest behind a stalled consumer, the newest value must survive
+
+    void BM_EnqueueDropOldest(benchmark::State& state) {
+        auto bus = std::make_shared<microbus::event_bus>();
+        auto topic = bus->topic<int64_t>("OnQuote");
+        std::atomic<bool> stalled{true};
+        std::atomic<int64_t> newest{-1};
+        bus->subscribe(topic, [&](int64_t value) {
+            while (stalled.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+            }
+            newest.store(std::max(newest.load(std::memory_order_relaxed), value), std::memory_order_relaxed);
+        });
+        microbus::event_loop loop(microbus::event_loop_options{64, microbus::overflow_policy::drop_oldest});
+        int64_t value = 0;
+        for (auto _ : state) {
+            loop.enqueue_event(bus, topic, value++);
+        }
+        stalled = false;
+        loop.wait_until_finished();
+        if (newest.load() != value - 1) {
+            state.SkipWithError("drop_oldest lost the newest event");
+        }
+        state.counters["dropped"] = static_cast<double>(loop.dropped());
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_EnqueueDropOldest)->UseRealTime();
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // End-to-end enqueue to handler latency
+
+    void BM_EnqueueLatency(benchmark::State& state) {
+        auto bus = std::make_shared<microbus::event_bus>();
+        auto topic = bus->topic<clock_type::time_point>("OnPing");
+        std::vector<int64_t> samples;
+        samples.reserve(1 << 20);
+        std::atomic<bool> handled{false};
+        bus->subscribe(topic, [&](clock_type::time_point sent) {
+            samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - sent).count());
+            handled.store(true, std::memory_order_release);
+        });
+        microbus::event_loop loop;
+        for (auto _ : state) {
+            handled.store(false, std::memory_order_relaxed);
+            loop.enqueue_event(bus, topic, clock_type::now());
+            while (!handled.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+        loop.wait_until_finished();
+        if (!samples.empty()) {
+            std::sort(samples.begin(), samples.end());
+            auto percentile = [&samples](double p) {
+                return static_cast<double>(samples[static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1))]);
+            };
+            state.counters["p50_ns"] = percentile(0.50);
+            state.counters["p99_ns"] = percentile(0.99);
+            state.counters["p999_ns"] = percentile(0.999);
+            state.counters["max_ns"] = static_cast<double>(samples.back());
+        }
+    }
+    BENCHMARK(BM_EnqueueLatency)->UseRealTime();
+
+    void BM_EnqueuePoll(benchmark::State& state) {
+        auto bus = std::make_shared<microbus::event_bus>();
+        auto topic = bus->topic<int>("OnValue");
+        int64_t sum = 0;
+        bus->subscribe(topic, [&sum](int value) { sum += value; });
+        microbus::event_loop_options options;
+        options.worker_count = 0;
+        microbus::event_loop loop(options);
+        for (auto _ : state) {
+            loop.enqueue_event(bus, topic, 1);
+            loop.poll();
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_EnqueuePoll);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Request/reply through a temporary reply topic against the correlation table
+
+    void BM_RequestReplyTopic(benchmark::State& state) {
+        microbus::event_bus bus;
+        auto request = bus.topic<std::string, int>("OnRequest");
+        bus.subscribe(request, [&bus](const std::string& reply_to, int value) { bus.trigger(reply_to, value); });
+        int64_t next = 0;
+        for (auto _ : state) {
+            auto reply_to = "OnReply." + std::to_string(next++ % 64);
+            int result = 0;
+            auto reply = bus.topic<int>(reply_to);
+            int id = bus.subscribe(reply, [&result](int value) { result = value; });
+            bus.trigger(request, reply_to, 1);
+            bus.unsubscribe(reply, id);
+            benchmark::DoNotOptimize(result);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_RequestReplyTopic);
+
+    void BM_Request(benchmark::State& state) {
+        microbus::event_bus bus;
+        auto request = bus.topic<microbus::reply<int>, int>("OnRequest");
+        bus.subscribe(request, [](const microbus::reply<int>& reply, int value) { reply.send(value); });
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(bus.request(request, 1).get());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_Request);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Sequential against parallel fan-out to 40 CPU-heavy subscribers
+
+    void spin_for(std::chrono::microseconds work) {
+        auto end = clock_type::now() + work;
+        while (clock_type::now() < end) {
+        }
+    }
+
+    void BM_FanOut(benchmark::State& state) {
+        auto bus = std::make_shared<microbus::event_bus>();
+        auto topic = bus->topic<int>("OnAnalytics");
+        for (int i = 0; i < 40; ++i) {
+            bus->subscribe(topic, [](int) { spin_for(std::chrono::microseconds(20)); });
+        }
+        microbus::event_loop loop(static_cast<std::size_t>(std::max<int64_t>(state.range(0), 1)));
+        for (auto _ : state) {
+            if (state.range(0) == 0) {
+                bus->trigger(topic, 1);
+            } else {
+                loop.trigger_parallel(bus, topic, 1).wait();
+            }
+        }
+        state.SetLabel(state.range(0) == 0 ? "sequential" : "workers");
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_FanOut)->Arg(0)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Subscribe/unsubscribe churn concurrent with triggers
+
+    std::unique_ptr<microbus::event_bus> churn_bus;
+    microbus::topic_handle<int> churn_topic;
+    microbus::topic_handle<int> churn_hot_topic;
+    std::atomic<int64_t> churn_sum{0};
+
+    void BM_TriggerUnderChurn(benchmark::State& state) {
+        if (state.thread_index() == 0) {
+            churn_bus = std::make_unique<microbus::event_bus>();
+            churn_topic = churn_bus->topic<int>("OnChurn");
+            churn_hot_topic = churn_bus->topic<int>("OnHot");
+            churn_bus->subscribe(churn_hot_topic, [](int value) { churn_sum.fetch_add(value, std::memory_order_relaxed); });
+        }
+        if (state.thread_index() == 0) {
+            // Thread 0 churns short-lived subscribers, on an unrelated topic or on the one being triggered.
+            auto& topic = state.range(0) == 0 ? churn_topic : churn_hot_topic;
+            for (auto _ : state) {
+                int id = churn_bus->subscribe(topic, [](int value) { churn_sum.fetch_add(value, std::memory_order_relaxed); });
+                churn_bus->unsubscribe(topic, id);
+            }
+            state.SetLabel(state.range(0) == 0 ? "churn other topic" : "churn triggered topic");
+        } else {
+            for (auto _ : state) {
+                churn_bus->trigger(churn_hot_topic, 1);
+            }
+            state.SetItemsProcessed(state.iterations());
+        }
+    }
+    BENCHMARK(BM_TriggerUnderChurn)->Arg(0)->Arg(1)->ThreadRange(2, 16)->UseRealTime();
+
+    void BM_ChurnLargeTopic(benchmark::State& state) {
+        microbus::event_bus bus;
+        auto topic = bus.topic<int>("OnValue");
+        int64_t sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            bus.subscribe(topic, [&sum](int value) { sum += value; });
+        }
+        for (auto _ : state) {
+            int id = bus.subscribe(topic, [&sum](int value) { sum -= value; });
+            bus.trigger(topic, 1);
+            bus.unsubscribe(topic, id);
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_ChurnLargeTopic)->Arg(8)->Arg(1024)->Arg(4096);
+}
+
+BENCHMARK_MAIN();
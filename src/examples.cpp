@@ -49,6 +49,21 @@ int main() {
     // Clear all events
     events.clear();
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Interned topic handle example
+
+    // Resolve the topic once, then trigger it without hashing the name.
+    auto on_calc = events.topic<double, int>("OnCalc");
+
+    int topic_subscription_id = events.subscribe(on_calc, [](double value, int multiply_by) {
+        std::cout << "Topic " << value << " times " << multiply_by << " is " << (value * multiply_by) << std::endl;
+    });
+
+    events.trigger(on_calc, pie, 2);
+
+    events.unsubscribe(on_calc, topic_subscription_id);
+    events.clear();
+
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Smart pointer passed off-thread example
 
@@ -93,14 +108,15 @@ int main() {
 
     shared_event_bus->subscribe<int>("OnFactorial", compute_factorial);
 
-    std::vector<uint64_t> numbers_to_factorial1 = {15, 17, 19};
-    std::vector<uint64_t> numbers_to_factorial2 = {16, 18, 20};
+    // Argument types must match the topic signature, a uint64_t would be rejected here.
+    std::vector<int> numbers_to_factorial1 = {15, 17, 19};
+    std::vector<int> numbers_to_factorial2 = {16, 18, 20};
 
-    for (uint64_t number : numbers_to_factorial1) {
+    for (int number : numbers_to_factorial1) {
         event_loop.enqueue_event(shared_event_bus, "OnFactorial", number);
     }
 
-    for (uint64_t number : numbers_to_factorial2) {
+    for (int number : numbers_to_factorial2) {
         event_loop.enqueue_event(shared_event_bus, "OnFactorial", number);
     }
 
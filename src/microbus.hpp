@@ -25,254 +25,6367 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <algorithm>
 #include <functional>
 #include <mutex>
-#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <tuple>
 #include <type_traits>
-#include <queue>
 #include <thread>
 #include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <new>
+#include <cstddef>
+#include <stdexcept>
+#include <optional>
+#include <chrono>
+#include <future>
+#include <iterator>
+#include <exception>
+#include <cstdio>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+/// Defined to 1 when C++20 coroutines are available, enabling `co_await` on topics and loops.
+#define MICROBUS_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifndef MICROBUS_HAS_COROUTINES
+#define MICROBUS_HAS_COROUTINES 0
+#endif
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fstream>
+#include <system_error>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef MICROBUS_HANDLER_INLINE_SIZE
+/// Bytes of inline storage per subscriber, larger callables are heap allocated.
+#define MICROBUS_HANDLER_INLINE_SIZE 48
+#endif
+
+#ifndef MICROBUS_EVENT_INLINE_SIZE
+/// Bytes of inline storage per queued event, larger events are heap allocated.
+#define MICROBUS_EVENT_INLINE_SIZE 96
+#endif
+
+#ifndef MICROBUS_ENABLE_METRICS
+/// Set to 1 to collect topic counters, handler times and queue statistics, see `event_bus::metrics()`.
+#define MICROBUS_ENABLE_METRICS 0
+#endif
+
+#ifndef MICROBUS_BUS_SHARDS
+/// Default number of independently locked subscription shards of an event bus.
+#define MICROBUS_BUS_SHARDS 16
+#endif
+
+#ifndef MICROBUS_METRICS_SHARDS
+/// Number of cache lines each metrics counter is spread over, threads update their own shard.
+#define MICROBUS_METRICS_SHARDS 8
+#endif
 
 namespace microbus {
 
     /**
-     * @brief A base class for type-erased handlers.
+     * @brief Thrown when a topic is used with argument types that differ from the ones it was bound to.
+     */
+    class signature_mismatch : public std::logic_error {
+    public:
+        /**
+         * @brief Constructs the exception for a topic.
+         * @param event_name The name of the event.
+         */
+        explicit signature_mismatch(const std::string& event_name)
+                : std::logic_error("microbus: argument types do not match the signature of topic '" + event_name + "'") {}
+    };
+
+    class event_bus;
+    class event_loop;
+
+    /**
+     * @brief What a bus does when an event handler throws.
+     */
+    enum class error_policy {
+        propagate, ///< Rethrow to the caller of the trigger, later subscribers of the event are not called.
+        log, ///< Report the error to `error_options::on_error`, or standard error without one, and call the next subscriber.
+        dead_letter, ///< Publish a `handler_error` on `event_bus::dead_letter_topic` and call the next subscriber.
+        retry, ///< Call the failed subscriber again after a backoff, then treat the event as a dead letter.
+    };
+
+    /**
+     * @brief An exception thrown by an event handler, as published on the dead letter topic.
+     */
+    struct handler_error {
+        std::string topic; ///< The name of the topic the event was triggered on.
+        int subscription = -1; ///< The ID of the subscription whose handler threw.
+        std::exception_ptr error; ///< The captured exception.
+        unsigned attempts = 1; ///< Number of times the handler was called with the event.
+    };
+
+    /**
+     * @brief Error handling of an event bus, see `event_bus::set_error_options`.
+     */
+    struct error_options {
+        error_policy policy = error_policy::propagate; ///< What to do when a handler throws.
+        std::function<void(const handler_error&)> on_error{}; ///< Receives logged errors and dead letters nobody subscribed to, empty for standard error.
+        event_loop* retry_loop = nullptr; ///< Loop that runs retries from its timer wheel, it must outlive the bus; nullptr to skip retries.
+        unsigned max_retries = 3; ///< Retries before an event becomes a dead letter.
+        std::chrono::nanoseconds backoff = std::chrono::milliseconds(1); ///< Delay before the first retry, doubled for every further one.
+    };
+
+    /**
+     * @brief Whether the library was built with `MICROBUS_ENABLE_METRICS`.
+     */
+    inline constexpr bool metrics_enabled = MICROBUS_ENABLE_METRICS != 0;
+
+    /**
+     * @brief A scraped latency histogram, in nanoseconds.
+     */
+    struct histogram_snapshot {
+        std::uint64_t count = 0; ///< Number of recorded samples.
+        std::uint64_t sum = 0; ///< Sum of the recorded samples.
+        std::uint64_t max = 0; ///< Largest recorded sample.
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> buckets; ///< Upper bound and sample count of each non-empty bucket, ascending.
+
+        /**
+         * @brief Gets the mean of the samples.
+         * @return The mean, zero without samples.
+         */
+        [[nodiscard]] double mean() const {
+            return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+        }
+
+        /**
+         * @brief Gets an upper bound of a quantile, accurate to the bucket width (1/8 of its magnitude).
+         * @param quantile The quantile, between 0 and 1.
+         * @return The upper bound of the bucket holding the quantile, zero without samples.
+         */
+        [[nodiscard]] std::uint64_t percentile(double quantile) const {
+            auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(count));
+            std::uint64_t seen = 0;
+            for (const auto& [bound, samples] : buckets) {
+                seen += samples;
+                if (seen > rank || seen == count) {
+                    return std::min(bound, max);
+                }
+            }
+            return 0;
+        }
+    };
+
+    /**
+     * @brief Scraped statistics of one subscriber.
+     */
+    struct subscriber_metrics {
+        int id = 0; ///< The subscription ID.
+        histogram_snapshot handler_ns; ///< Time spent in the handler per call.
+    };
+
+    /**
+     * @brief Scraped statistics of one topic.
+     */
+    struct topic_metrics {
+        std::string name; ///< The name of the topic.
+        std::uint64_t published = 0; ///< Events triggered or run by an event loop.
+        std::uint64_t delivered = 0; ///< Handler calls made for those events.
+        std::vector<subscriber_metrics> subscribers; ///< Current subscribers in subscription order.
+    };
+
+    /**
+     * @brief Scraped statistics of one event loop queue.
+     */
+    struct queue_metrics {
+        std::size_t depth = 0; ///< Events currently queued.
+        std::size_t high_water = 0; ///< Largest depth seen by a producer.
+    };
+
+    /**
+     * @brief Scraped statistics of an event loop.
      */
-    struct type_erased_handler {
-        virtual ~type_erased_handler() = default;
+    struct loop_metrics {
+        std::uint64_t enqueued = 0; ///< Events accepted by the loop.
+        std::uint64_t processed = 0; ///< Events that finished running.
+        std::uint64_t dropped = 0; ///< Events discarded by the overflow policy.
+        std::size_t queued_bytes = 0; ///< Payload bytes currently held against `event_loop_options::byte_capacity`.
+        std::vector<queue_metrics> queues; ///< Per worker: the priority lanes from high to low, followed by the ordered queue if there is one.
+        histogram_snapshot queue_latency_ns; ///< Time from enqueue until an event starts running.
+    };
+
+    namespace detail {
+#if MICROBUS_ENABLE_METRICS
+        /**
+         * @brief Gets the metrics shard of the calling thread.
+         * @return The shard index.
+         */
+        inline std::size_t metrics_shard() {
+            static std::atomic<std::size_t> next{0};
+            thread_local std::size_t shard = next.fetch_add(1, std::memory_order_relaxed) % MICROBUS_METRICS_SHARDS;
+            return shard;
+        }
+
+        /**
+         * @brief A group of counters spread over per-thread cache lines.
+         * @tparam N Number of counters in the group.
+         */
+        template <std::size_t N>
+        class sharded_counters {
+        public:
+            /**
+             * @brief Adds to a counter in the shard of the calling thread.
+             * @param index The counter.
+             * @param value The amount to add.
+             */
+            void add(std::size_t index, std::uint64_t value) {
+                shards_[metrics_shard()].values_[index].fetch_add(value, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Sums a counter over all shards.
+             * @param index The counter.
+             * @return The total.
+             */
+            [[nodiscard]] std::uint64_t load(std::size_t index) const {
+                std::uint64_t total = 0;
+                for (const auto& shard : shards_) {
+                    total += shard.values_[index].load(std::memory_order_relaxed);
+                }
+                return total;
+            }
+
+        private:
+            struct alignas(64) shard {
+                std::atomic<std::uint64_t> values_[N] = {}; ///< The counters of the shard.
+            };
+
+            shard shards_[MICROBUS_METRICS_SHARDS]; ///< One shard per thread slot.
+        };
+
+        /**
+         * @brief A lock-free log-linear latency histogram in nanoseconds.
+         *
+         * Every power of two is split into 8 linear buckets, so bucket bounds are within 12.5%
+         * of the recorded values. Samples above 2^48 ns land in the last bucket.
+         */
+        class latency_histogram {
+        public:
+            static constexpr unsigned sub_bits = 3; ///< Linear buckets per power of two as a power of two.
+            static constexpr unsigned max_magnitude = 47; ///< Highest power of two with its own buckets.
+            static constexpr std::size_t bucket_count = (max_magnitude - sub_bits + 2) << sub_bits; ///< Number of buckets.
+
+            /**
+             * @brief Records a sample.
+             * @param ns The sample in nanoseconds.
+             */
+            void record(std::uint64_t ns) {
+                buckets_[index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+                count_.fetch_add(1, std::memory_order_relaxed);
+                sum_.fetch_add(ns, std::memory_order_relaxed);
+                auto max = max_.load(std::memory_order_relaxed);
+                while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+                }
+            }
+
+            /**
+             * @brief Adds the samples to a snapshot that is being built.
+             * @param counts Dense bucket counts of the snapshot, `bucket_count` elements.
+             * @param out The snapshot.
+             */
+            void merge_into(std::vector<std::uint64_t>& counts, histogram_snapshot& out) const {
+                for (std::size_t i = 0; i < bucket_count; ++i) {
+                    counts[i] += buckets_[i].load(std::memory_order_relaxed);
+                }
+                out.count += count_.load(std::memory_order_relaxed);
+                out.sum += sum_.load(std::memory_order_relaxed);
+                out.max = std::max(out.max, max_.load(std::memory_order_relaxed));
+            }
+
+            /**
+             * @brief Completes a snapshot from its dense bucket counts.
+             * @param counts Dense bucket counts, `bucket_count` elements.
+             * @param out The snapshot.
+             */
+            static void finish(const std::vector<std::uint64_t>& counts, histogram_snapshot& out) {
+                for (std::size_t i = 0; i < bucket_count; ++i) {
+                    if (counts[i]) {
+                        auto bound = i + 1 < bucket_count ? lower_bound_of(i + 1) - 1 : UINT64_MAX;
+                        out.buckets.emplace_back(bound, counts[i]);
+                    }
+                }
+            }
+
+            /**
+             * @brief Takes a snapshot of a single histogram.
+             * @return The snapshot.
+             */
+            [[nodiscard]] histogram_snapshot snapshot() const {
+                histogram_snapshot out;
+                std::vector<std::uint64_t> counts(bucket_count);
+                merge_into(counts, out);
+                finish(counts, out);
+                return out;
+            }
+
+        private:
+            static std::size_t index_of(std::uint64_t ns) {
+                if (ns < (1u << sub_bits)) {
+                    return static_cast<std::size_t>(ns);
+                }
+#if defined(__GNUC__)
+                unsigned magnitude = 63 - static_cast<unsigned>(__builtin_clzll(ns));
+#else
+                unsigned magnitude = sub_bits;
+                while (magnitude < 63 && (ns >> (magnitude + 1))) {
+                    ++magnitude;
+                }
+#endif
+                if (magnitude > max_magnitude) {
+                    return bucket_count - 1;
+                }
+                auto sub = (ns >> (magnitude - sub_bits)) & ((1u << sub_bits) - 1);
+                return ((magnitude - sub_bits + 1) << sub_bits) + static_cast<std::size_t>(sub);
+            }
+
+            static std::uint64_t lower_bound_of(std::size_t index) {
+                if (index < (1u << sub_bits)) {
+                    return index;
+                }
+                auto magnitude = static_cast<unsigned>(index >> sub_bits) + sub_bits - 1;
+                auto sub = static_cast<std::uint64_t>(index & ((1u << sub_bits) - 1));
+                return ((std::uint64_t{1} << sub_bits) + sub) << (magnitude - sub_bits);
+            }
+
+            std::atomic<std::uint64_t> buckets_[bucket_count] = {}; ///< Sample count per bucket.
+            std::atomic<std::uint64_t> count_{0}; ///< Number of samples.
+            std::atomic<std::uint64_t> sum_{0}; ///< Sum of the samples.
+            std::atomic<std::uint64_t> max_{0}; ///< Largest sample.
+        };
+
+        /**
+         * @brief Records the time spent in a scope.
+         */
+        class scoped_timer {
+        public:
+            explicit scoped_timer(latency_histogram& histogram)
+                    : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+            ~scoped_timer() {
+                auto elapsed = std::chrono::steady_clock::now() - start_;
+                histogram_.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+            scoped_timer(const scoped_timer&) = delete;
+            scoped_timer& operator=(const scoped_timer&) = delete;
+
+        private:
+            latency_histogram& histogram_; ///< Receives the elapsed time.
+            std::chrono::steady_clock::time_point start_; ///< Start of the scope.
+        };
+#endif
+
+        /**
+         * @brief Unique address per decayed topic signature, used for run-time signature checks.
+         * @tparam Ts Decayed argument types.
+         */
+        template <typename... Ts>
+        inline char signature_tag = 0;
+
+        /**
+         * @brief Gets the signature identity of a set of argument types.
+         * @tparam Args Argument types, references and cv-qualifiers are ignored.
+         * @return The signature identity.
+         */
+        template <typename... Args>
+        const void* signature_of() {
+            return &signature_tag<std::decay_t<Args>...>;
+        }
+
+        /**
+         * @brief Process-wide pool of fixed-size blocks with a cache per thread, the default memory resource of buses and loops.
+         *
+         * Blocks come in power-of-two size classes from 128 bytes to `max_block`. Each thread
+         * allocates from and frees into its own lists without locking. A thread that frees more
+         * than it allocates, such as a loop worker running events packed by producers, hands
+         * batches back to a locked central list, where allocating threads refill from. Slabs are
+         * carved from the global heap once and kept, so a steady state does not allocate. Larger
+         * or over-aligned requests go to `std::pmr::new_delete_resource()`.
+         */
+        class slab_pool final : public std::pmr::memory_resource {
+        public:
+            static constexpr std::size_t max_block = 4096; ///< Largest pooled block size.
+
+            /**
+             * @brief Gets the pool.
+             * @return The pool, which is never destroyed so that exiting threads can return their blocks.
+             */
+            static slab_pool& instance() {
+                static auto* pool = new slab_pool();
+                return *pool;
+            }
+
+        private:
+            static constexpr std::size_t min_block = 128; ///< Smallest block size.
+            static constexpr std::size_t class_count = 6; ///< Number of size classes.
+            static constexpr std::size_t batch = 32; ///< Blocks moved between a thread and the central lists at once.
+
+            /**
+             * @brief A free block, linked through its first bytes.
+             */
+            struct free_block {
+                free_block* next_; ///< The next free block.
+            };
+
+            /**
+             * @brief Free blocks of one size class shared by all threads.
+             */
+            struct alignas(64) central_list {
+                std::mutex mutex_; ///< Guards the list.
+                free_block* head_ = nullptr; ///< First free block.
+                std::vector<std::unique_ptr<std::byte[]>> slabs_; ///< Memory the blocks were carved from.
+            };
+
+            /**
+             * @brief Free blocks owned by one thread.
+             */
+            struct thread_cache {
+                free_block* heads_[class_count] = {}; ///< First free block per size class.
+                std::size_t counts_[class_count] = {}; ///< Number of free blocks per size class.
+
+                ~thread_cache() {
+                    for (std::size_t c = 0; c < class_count; ++c) {
+                        instance().give_back(c, heads_[c], counts_[c]);
+                    }
+                }
+            };
+
+            slab_pool() = default;
+
+            /**
+             * @brief Gets the size class of a request.
+             * @param bytes The requested size, at most `max_block`.
+             * @return The class index.
+             */
+            static std::size_t class_of(std::size_t bytes) {
+                std::size_t c = 0;
+                for (auto size = min_block; size < bytes; size <<= 1) {
+                    ++c;
+                }
+                return c;
+            }
+
+            /**
+             * @brief Gets the free lists of the calling thread.
+             * @return The thread cache.
+             */
+            static thread_cache& cache() {
+                thread_local thread_cache local;
+                return local;
+            }
+
+            void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+                if (bytes > max_block || alignment > alignof(std::max_align_t)) {
+                    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+                }
+                auto c = class_of(bytes);
+                auto& local = cache();
+                if (!local.heads_[c]) {
+                    refill(local, c);
+                }
+                auto* block = local.heads_[c];
+                local.heads_[c] = block->next_;
+                --local.counts_[c];
+                return block;
+            }
+
+            void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override {
+                if (bytes > max_block || alignment > alignof(std::max_align_t)) {
+                    std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+                    return;
+                }
+                auto c = class_of(bytes);
+                auto& local = cache();
+                auto* block = static_cast<free_block*>(ptr);
+                block->next_ = local.heads_[c];
+                local.heads_[c] = block;
+                if (++local.counts_[c] >= 2 * batch) {
+                    // Keep one batch for the next allocations and return the rest.
+                    auto* tail = local.heads_[c];
+                    for (std::size_t i = 1; i < batch; ++i) {
+                        tail = tail->next_;
+                    }
+                    auto* rest = tail->next_;
+                    tail->next_ = nullptr;
+                    give_back(c, rest, local.counts_[c] - batch);
+                    local.counts_[c] = batch;
+                }
+            }
+
+            [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+
+            /**
+             * @brief Moves a batch of blocks from the central list into a thread cache, carving a new slab if it is empty.
+             * @param local The thread cache, whose list of the class is empty.
+             * @param c The size class.
+             */
+            void refill(thread_cache& local, std::size_t c) {
+                auto& central = central_[c];
+                std::lock_guard lock(central.mutex_);
+                if (!central.head_) {
+                    auto size = min_block << c;
+                    auto& slab = central.slabs_.emplace_back(new std::byte[size * batch]);
+                    for (std::size_t i = batch; i-- > 0;) {
+                        auto* block = reinterpret_cast<free_block*>(slab.get() + i * size);
+                        block->next_ = central.head_;
+                        central.head_ = block;
+                    }
+                }
+                std::size_t count = 0;
+                auto* tail = central.head_;
+                while (++count < batch && tail->next_) {
+                    tail = tail->next_;
+                }
+                local.heads_[c] = central.head_;
+                central.head_ = tail->next_;
+                tail->next_ = nullptr;
+                local.counts_[c] = count;
+            }
+
+            /**
+             * @brief Returns a list of free blocks to the central list.
+             * @param c The size class.
+             * @param head The first block, may be nullptr.
+             * @param count Number of blocks in the list.
+             */
+            void give_back(std::size_t c, free_block* head, std::size_t count) {
+                if (!head) {
+                    return;
+                }
+                auto* tail = head;
+                for (std::size_t i = 1; i < count; ++i) {
+                    tail = tail->next_;
+                }
+                auto& central = central_[c];
+                std::lock_guard lock(central.mutex_);
+                tail->next_ = central.head_;
+                central.head_ = head;
+            }
+
+            central_list central_[class_count]; ///< Shared free lists per size class.
+        };
+
+        /**
+         * @brief Gets the memory resource to use, the built-in pool if none is given.
+         * @param resource The configured resource, may be nullptr.
+         * @return The resource.
+         */
+        inline std::pmr::memory_resource* resource_or_pool(std::pmr::memory_resource* resource) {
+            return resource ? resource : &slab_pool::instance();
+        }
+
+        /**
+         * @brief A copyable callable with inline storage, used to store subscribers by value.
+         *
+         * Callables up to `MICROBUS_HANDLER_INLINE_SIZE` bytes that are nothrow movable live inside
+         * the object, larger ones fall back to a heap allocation. Handlers are called with lvalues,
+         * except through `consume()`, which moves the arguments into handlers that accept rvalues.
+         *
+         * @tparam Ts Decayed argument types.
+         */
+        template <typename... Ts>
+        class inline_handler {
+        public:
+            /**
+             * @brief Constructs the handler from a callable.
+             * @tparam Fn Type of the callable, invocable with lvalues or rvalues of `Ts...`.
+             * @param fn The callable.
+             */
+            template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, inline_handler>>>
+            explicit inline_handler(Fn&& fn) {
+                using fn_type = std::decay_t<Fn>;
+                constexpr bool in_place = stored_inline<fn_type>;
+                if constexpr (in_place) {
+                    ::new (static_cast<void*>(storage_)) fn_type(std::forward<Fn>(fn));
+                    manage_ = [](operation op, void* dst, void* src) {
+                        switch (op) {
+                            case operation::copy: ::new (dst) fn_type(*static_cast<const fn_type*>(src)); break;
+                            case operation::move: ::new (dst) fn_type(std::move(*static_cast<fn_type*>(src))); break;
+                            case operation::destroy: static_cast<fn_type*>(dst)->~fn_type(); break;
+                        }
+                    };
+                } else {
+                    ::new (static_cast<void*>(storage_)) fn_type*(new fn_type(std::forward<Fn>(fn)));
+                    manage_ = [](operation op, void* dst, void* src) {
+                        switch (op) {
+                            case operation::copy: ::new (dst) fn_type*(new fn_type(**static_cast<fn_type* const*>(src))); break;
+                            case operation::move: ::new (dst) fn_type*(*static_cast<fn_type**>(src)); *static_cast<fn_type**>(src) = nullptr; break;
+                            case operation::destroy: delete *static_cast<fn_type**>(dst); break;
+                        }
+                    };
+                }
+                if constexpr (std::is_invocable_v<fn_type&, Ts&...> || (std::is_copy_constructible_v<Ts> && ...)) {
+                    invoke_ = &call_shared<fn_type, in_place>;
+                }
+                consume_ = &call_last<fn_type, in_place>;
+            }
+
+            inline_handler(const inline_handler& other) : invoke_(other.invoke_), consume_(other.consume_), manage_(other.manage_) {
+                manage_(operation::copy, storage_, const_cast<unsigned char*>(other.storage_));
+            }
+
+            inline_handler(inline_handler&& other) noexcept : invoke_(other.invoke_), consume_(other.consume_), manage_(other.manage_) {
+                manage_(operation::move, storage_, other.storage_);
+            }
+
+            inline_handler& operator=(const inline_handler&) = delete;
+            inline_handler& operator=(inline_handler&&) = delete;
+
+            ~inline_handler() {
+                manage_(operation::destroy, storage_, nullptr);
+            }
+
+            /**
+             * @brief Invokes the callable, leaving the arguments intact for the next subscriber.
+             *
+             * Handlers that only accept rvalues receive copies.
+             *
+             * @param args The arguments.
+             */
+            void operator()(Ts&... args) const {
+                invoke_(const_cast<unsigned char*>(storage_), args...);
+            }
+
+            /**
+             * @brief Invokes the callable as the last subscriber, moving the arguments if it accepts rvalues.
+             * @param args The arguments, left in a moved-from state.
+             */
+            void consume(Ts&... args) const {
+                consume_(const_cast<unsigned char*>(storage_), args...);
+            }
+
+            /**
+             * @brief Checks whether the callable can run before other subscribers.
+             * @return False if it needs ownership of arguments that cannot be copied.
+             */
+            [[nodiscard]] bool shareable() const {
+                return invoke_ != nullptr;
+            }
+
+        private:
+            enum class operation { copy, move, destroy };
+
+            template <typename Fn>
+            static constexpr bool stored_inline = sizeof(Fn) <= MICROBUS_HANDLER_INLINE_SIZE &&
+                                                  alignof(Fn) <= alignof(std::max_align_t) &&
+                                                  std::is_nothrow_move_constructible_v<Fn>;
+
+            /**
+             * @brief Gets the stored callable.
+             * @tparam Fn Type of the callable.
+             * @tparam InPlace Whether the callable lives in the inline storage.
+             * @param storage The inline storage.
+             * @return The callable.
+             */
+            template <typename Fn, bool InPlace>
+            static Fn& target(void* storage) {
+                if constexpr (InPlace) {
+                    return *static_cast<Fn*>(storage);
+                } else {
+                    return **static_cast<Fn**>(storage);
+                }
+            }
+
+            template <typename Fn, bool InPlace>
+            static void call_shared(void* storage, Ts&... args) {
+                if constexpr (std::is_invocable_v<Fn&, Ts&...>) {
+                    target<Fn, InPlace>(storage)(args...);
+                } else {
+                    target<Fn, InPlace>(storage)(Ts(args)...);
+                }
+            }
+
+            template <typename Fn, bool InPlace>
+            static void call_last(void* storage, Ts&... args) {
+                if constexpr (std::is_invocable_v<Fn&, Ts&&...>) {
+                    target<Fn, InPlace>(storage)(std::move(args)...);
+                } else {
+                    target<Fn, InPlace>(storage)(args...);
+                }
+            }
+
+            alignas(std::max_align_t) unsigned char storage_[MICROBUS_HANDLER_INLINE_SIZE]; ///< Inline callable storage.
+            void (*invoke_)(void*, Ts&...) = nullptr; ///< Calls the stored callable with lvalues, nullptr if it cannot be shared.
+            void (*consume_)(void*, Ts&...); ///< Calls the stored callable with rvalues where it accepts them.
+            void (*manage_)(operation, void*, void*); ///< Copies, moves or destroys the stored callable.
+        };
+
+        /**
+         * @brief Type-erased view of a subscriber snapshot.
+         *
+         * Readers only ever see a published prefix of the entries: the owning shard's writer may append
+         * entries past it and tombstone entries in place, everything else builds a new snapshot.
+         */
+        struct subscriber_list_base {
+            virtual ~subscriber_list_base() = default;
+
+            /**
+             * @brief Removes a subscription, the caller must hold the shard lock of the topic.
+             *
+             * Inline subscribers are tombstoned in O(1). The snapshot is compacted into a new one once
+             * tombstones outnumber the live entries, so the cost is amortized over the removals.
+             *
+             * @param id The subscription ID.
+             * @return The snapshot to publish: this one, a compacted copy, or nullptr if no subscriber is left.
+             */
+            [[nodiscard]] virtual const subscriber_list_base* remove(int id) = 0;
+
+#if MICROBUS_ENABLE_METRICS
+            /**
+             * @brief Gets the number of subscribers.
+             * @return The subscriber count.
+             */
+            [[nodiscard]] virtual std::size_t size() const = 0;
+
+            /**
+             * @brief Appends the statistics of every subscriber.
+             * @param out The topic statistics.
+             */
+            virtual void collect(std::vector<subscriber_metrics>& out) const = 0;
+#endif
+        };
+
+        /**
+         * @brief Contiguous subscriber snapshot for one topic signature.
+         *
+         * Tombstone flags and entries live in two parallel arrays, so a trigger is a linear scan over
+         * inline callables. Appending fills reserved capacity in place and publishes the new count;
+         * only a full array or a compaction copies the live entries into a snapshot of twice their size.
+         *
+         * @tparam Ts Decayed argument types of the topic.
+         */
+        template <typename... Ts>
+        struct subscriber_list final : subscriber_list_base {
+            /**
+             * @brief A subscription stored by value.
+             */
+            struct entry {
+                int id_; ///< The subscription ID.
+                inline_handler<Ts...> handler_; ///< The subscribed callable.
+#if MICROBUS_ENABLE_METRICS
+                std::shared_ptr<latency_histogram> time_; ///< Handler time, shared by the snapshots holding the subscription.
+#endif
+            };
+
+            /**
+             * @brief A subscription that runs on an executor, posted with the shared payload of an event.
+             */
+            struct remote_entry {
+                int id_; ///< The subscription ID.
+                inline_handler<std::shared_ptr<const std::tuple<Ts...>>> post_; ///< Posts the subscribed callable to its executor.
+#if MICROBUS_ENABLE_METRICS
+                std::shared_ptr<latency_histogram> time_; ///< Handler time on the executor.
+#endif
+            };
+
+            /**
+             * @brief Constructs an empty snapshot.
+             * @param capacity Number of entries that can be appended in place.
+             */
+            explicit subscriber_list(std::size_t capacity = 4)
+                : live_(std::make_unique<std::atomic<bool>[]>(capacity)), slots_(std::make_unique<slot[]>(capacity)), capacity_(capacity) {}
+
+            subscriber_list(const subscriber_list&) = delete;
+            subscriber_list& operator=(const subscriber_list&) = delete;
+
+            ~subscriber_list() override {
+                for (std::size_t i = 0, n = count_.load(std::memory_order_relaxed); i < n; ++i) {
+                    at(i).~entry();
+                }
+            }
+
+            /**
+             * @brief Checks whether an entry can be appended in place.
+             * @return True if the reserved capacity is used up.
+             */
+            [[nodiscard]] bool full() const {
+                return count_.load(std::memory_order_relaxed) == capacity_;
+            }
+
+            /**
+             * @brief Appends an entry and publishes it to readers, the caller must hold the shard lock and the snapshot must not be full.
+             * @param subscriber The entry.
+             */
+            void append(entry subscriber) {
+                auto position = count_.load(std::memory_order_relaxed);
+                ::new (static_cast<void*>(slots_[position].storage_)) entry(std::move(subscriber));
+                live_[position].store(true, std::memory_order_relaxed);
+                index_.emplace(at(position).id_, position);
+                live_count_.fetch_add(1, std::memory_order_relaxed);
+                count_.store(position + 1, std::memory_order_release);
+            }
+
+            /**
+             * @brief Gets the number of inline subscribers that are not tombstoned.
+             * @return The live count.
+             */
+            [[nodiscard]] std::size_t live_count() const {
+                return live_count_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Gets the last live inline subscriber, the caller must hold the shard lock.
+             * @return The entry, or nullptr if there is none.
+             */
+            [[nodiscard]] const entry* last_live() const {
+                for (auto i = count_.load(std::memory_order_relaxed); i-- > 0;) {
+                    if (live_[i].load(std::memory_order_relaxed)) {
+                        return &at(i);
+                    }
+                }
+                return nullptr;
+            }
+
+            /**
+             * @brief Copies the live subscribers into a new snapshot with room to grow, the caller must hold the shard lock.
+             * @param extra Number of entries about to be appended.
+             * @param skip ID of an inline subscriber to leave out, -1 for none.
+             * @param skip_remote ID of a subscriber bound to an executor to leave out, -1 for none.
+             * @return The copy.
+             */
+            [[nodiscard]] std::unique_ptr<subscriber_list> compacted(std::size_t extra, int skip = -1, int skip_remote = -1) const {
+                auto live = live_count_.load(std::memory_order_relaxed);
+                auto next = std::make_unique<subscriber_list>(std::max<std::size_t>(2 * (live + extra), 4));
+                for (std::size_t i = 0, n = count_.load(std::memory_order_relaxed); i < n; ++i) {
+                    if (live_[i].load(std::memory_order_relaxed) && at(i).id_ != skip) {
+                        next->append(at(i));
+                    }
+                }
+                next->remote_.reserve(remote_.size() + extra);
+                for (const auto& subscriber : remote_) {
+                    if (subscriber.id_ != skip_remote) {
+                        next->remote_.push_back(subscriber);
+                    }
+                }
+                return next;
+            }
+
+            /**
+             * @brief Calls every subscriber.
+             *
+             * Subscribers bound to an executor are posted first with one shared copy of the arguments,
+             * which is moved from the event when no inline subscriber follows. Entries appended or
+             * tombstoned while the scan runs may or may not be called.
+             *
+             * @param memory Allocates the shared arguments.
+             * @param args The arguments, passed to each handler as lvalues and moved into the last live one.
+             */
+            void invoke(std::pmr::memory_resource* memory, Ts&... args) const {
+                auto unused = [](int) {};
+                invoke_all<false>(memory, unused, args...);
+            }
+
+            /**
+             * @brief Calls every subscriber, reporting a handler that throws and going on with the next one.
+             *
+             * Copyable arguments are not moved into the last subscriber, so they are still intact when
+             * it throws.
+             *
+             * @tparam Fail Type of the error callback.
+             * @param memory Allocates the shared arguments.
+             * @param fail Called with the subscription ID inside the handler of the exception.
+             * @param args The arguments.
+             */
+            template <typename Fail>
+            void invoke_guarded(std::pmr::memory_resource* memory, Fail&& fail, Ts&... args) const {
+                invoke_all<true>(memory, fail, args...);
+            }
+
+            /**
+             * @brief Lists the live inline subscribers, to call them one by one with `invoke_one()`.
+             * @param out Receives the slot index and the subscription ID of every live subscriber.
+             * @return False if a subscriber needs ownership of arguments that cannot be copied.
+             */
+            bool targets(std::vector<std::pair<std::size_t, int>>& out) const {
+                auto count = count_.load(std::memory_order_acquire);
+                out.reserve(live_count_.load(std::memory_order_relaxed));
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (live_[i].load(std::memory_order_acquire)) {
+                        if (!at(i).handler_.shareable()) {
+                            return false;
+                        }
+                        out.emplace_back(i, at(i).id_);
+                    }
+                }
+                return true;
+            }
+
+            /**
+             * @brief Calls one inline subscriber if it is still subscribed.
+             * @tparam Fail Type of the error callback.
+             * @param id The subscription ID.
+             * @param hint Slot index the subscriber was last seen at, checked before scanning.
+             * @param fail Called inside the handler of the exception if the subscriber throws.
+             * @param args The arguments, passed as lvalues.
+             * @return False if the subscription is gone.
+             */
+            template <typename Fail>
+            bool invoke_one(int id, std::size_t hint, Fail&& fail, Ts&... args) const {
+                auto count = count_.load(std::memory_order_acquire);
+                if (hint < count && live_[hint].load(std::memory_order_acquire) && at(hint).id_ == id) {
+                    call<true>(at(hint), false, fail, args...);
+                    return true;
+                }
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (live_[i].load(std::memory_order_acquire) && at(i).id_ == id) {
+                        call<true>(at(i), false, fail, args...);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            [[nodiscard]] const subscriber_list_base* remove(int id) override {
+                auto it = index_.find(id);
+                if (it == index_.end()) {
+                    if (std::none_of(remote_.begin(), remote_.end(), [id](const remote_entry& e) { return e.id_ == id; })) {
+                        return this;
+                    }
+                    if (remote_.size() == 1 && live_count_.load(std::memory_order_relaxed) == 0) {
+                        return nullptr;
+                    }
+                    return compacted(0, -1, id).release();
+                }
+                live_[it->second].store(false, std::memory_order_release);
+                index_.erase(it);
+                auto live = live_count_.fetch_sub(1, std::memory_order_relaxed) - 1;
+                if (live == 0 && remote_.empty()) {
+                    return nullptr;
+                }
+                // A tombstoned callable stays alive until the snapshot is retired, compacting bounds how many linger.
+                if (++dead_ > live) {
+                    return compacted(0).release();
+                }
+                return this;
+            }
+
+#if MICROBUS_ENABLE_METRICS
+            [[nodiscard]] std::size_t size() const override {
+                return live_count_.load(std::memory_order_relaxed) + remote_.size();
+            }
+
+            void collect(std::vector<subscriber_metrics>& out) const override {
+                for (std::size_t i = 0, n = count_.load(std::memory_order_acquire); i < n; ++i) {
+                    if (live_[i].load(std::memory_order_acquire)) {
+                        out.push_back({at(i).id_, at(i).time_->snapshot()});
+                    }
+                }
+                for (const auto& subscriber : remote_) {
+                    out.push_back({subscriber.id_, subscriber.time_->snapshot()});
+                }
+            }
+#endif
+
+            std::vector<remote_entry> remote_; ///< Subscribers bound to an executor, in subscription order, fixed once published.
+
+        private:
+            /**
+             * @brief Calls every subscriber, see `invoke()` and `invoke_guarded()`.
+             * @tparam Guarded Whether a throwing handler is reported to `fail` instead of ending the trigger.
+             * @tparam Fail Type of the error callback.
+             * @param memory Allocates the shared arguments.
+             * @param fail The error callback.
+             * @param args The arguments.
+             */
+            template <bool Guarded, typename Fail>
+            void invoke_all([[maybe_unused]] std::pmr::memory_resource* memory, Fail& fail, Ts&... args) const {
+                auto count = count_.load(std::memory_order_acquire);
+                auto last = count;
+                for (auto i = count; i-- > 0;) {
+                    if (live_[i].load(std::memory_order_acquire)) {
+                        last = i;
+                        break;
+                    }
+                }
+                if constexpr (std::is_copy_constructible_v<std::tuple<Ts...>>) {
+                    if (!remote_.empty()) {
+                        std::pmr::polymorphic_allocator<std::tuple<Ts...>> allocator(memory);
+                        std::shared_ptr<const std::tuple<Ts...>> payload =
+                            last == count && !Guarded ? std::allocate_shared<std::tuple<Ts...>>(allocator, std::move(args)...)
+                                                      : std::allocate_shared<std::tuple<Ts...>>(allocator, args...);
+                        for (const auto& subscriber : remote_) {
+                            subscriber.post_(payload);
+                        }
+                    }
+                }
+                if (last == count) {
+                    return;
+                }
+                for (std::size_t i = 0; i < last; ++i) {
+                    if (live_[i].load(std::memory_order_acquire)) {
+                        call<Guarded>(at(i), false, fail, args...);
+                    }
+                }
+                if (live_[last].load(std::memory_order_acquire)) {
+                    call<Guarded>(at(last), !Guarded || !std::is_copy_constructible_v<std::tuple<Ts...>>, fail, args...);
+                }
+            }
+
+            /**
+             * @brief Calls the handler of one subscriber.
+             * @tparam Guarded Whether to catch an exception and report it to `fail`.
+             * @tparam Fail Type of the error callback.
+             * @param subscriber The subscriber.
+             * @param last Whether to move the arguments into the handler.
+             * @param fail The error callback.
+             * @param args The arguments.
+             */
+            template <bool Guarded, typename Fail>
+            static void call(const entry& subscriber, bool last, [[maybe_unused]] Fail& fail, Ts&... args) {
+#if MICROBUS_ENABLE_METRICS
+                scoped_timer timer(*subscriber.time_);
+#endif
+                if constexpr (Guarded) {
+                    try {
+                        last ? subscriber.handler_.consume(args...) : subscriber.handler_(args...);
+                    } catch (...) {
+                        fail(subscriber.id_);
+                    }
+                } else {
+                    last ? subscriber.handler_.consume(args...) : subscriber.handler_(args...);
+                }
+            }
+
+            /**
+             * @brief Storage of one entry, constructed when appended.
+             */
+            struct slot {
+                alignas(entry) unsigned char storage_[sizeof(entry)]; ///< The entry.
+            };
+
+            /**
+             * @brief Gets an appended entry.
+             * @param index The slot index.
+             * @return The entry.
+             */
+            [[nodiscard]] entry& at(std::size_t index) const {
+                return *std::launder(reinterpret_cast<entry*>(slots_[index].storage_));
+            }
+
+            std::unique_ptr<std::atomic<bool>[]> live_; ///< Tombstone flags, false for unused and removed slots, scanned apart from the entries.
+            std::unique_ptr<slot[]> slots_; ///< Entries in subscription order.
+            std::size_t capacity_; ///< Number of slots.
+            std::atomic<std::size_t> count_{0}; ///< Published slots, readers scan this prefix.
+            std::atomic<std::size_t> live_count_{0}; ///< Published slots that are not tombstoned.
+            std::size_t dead_ = 0; ///< Tombstoned slots, only used by the writer.
+            std::unordered_map<int, std::size_t> index_; ///< Slot of every live inline subscription, only used by the writer.
+        };
+
+        /**
+         * @brief Epoch-based reclamation for the read-mostly snapshots published by the bus.
+         *
+         * Readers pin the current epoch in a per-thread record (its own cache line) and
+         * never take a lock. Writers retire replaced snapshots, which are destroyed once
+         * every pinned reader has moved at least two epochs past the retirement.
+         */
+        class epoch_domain {
+        public:
+            epoch_domain(const epoch_domain&) = delete;
+            epoch_domain& operator=(const epoch_domain&) = delete;
+
+            /**
+             * @brief Gets the process-wide domain.
+             *
+             * The domain is intentionally never destroyed, so exiting threads can
+             * release their records regardless of static destruction order.
+             *
+             * @return The domain instance.
+             */
+            static epoch_domain& instance() {
+                static auto* domain = new epoch_domain();
+                return *domain;
+            }
+
+            /**
+             * @brief Pins the current epoch for the calling thread, pins nest.
+             */
+            void pin() {
+                auto& local = local_state();
+                if (local.nesting_++ == 0) {
+                    // Sequentially consistent with the writer's swap followed by its scan of the records.
+                    local.record_->state_.store((epoch_.load(std::memory_order_relaxed) << 1) | 1);
+                }
+            }
+
+            /**
+             * @brief Releases a pin taken by the calling thread.
+             */
+            void unpin() {
+                auto& local = local_state();
+                if (--local.nesting_ == 0) {
+                    local.record_->state_.store(0, std::memory_order_release);
+                }
+            }
+
+            /**
+             * @brief Schedules an unlinked object for destruction once no reader can observe it.
+             * @tparam T Type of the object.
+             * @param ptr The object, allocated with new.
+             */
+            template <typename T>
+            void retire(const T* ptr) {
+                if (!ptr) {
+                    return;
+                }
+                auto epoch = epoch_.load();
+                {
+                    std::lock_guard lock(retired_mutex_);
+                    retired_.push_back({const_cast<T*>(ptr), [](void* p) { delete static_cast<T*>(p); }, epoch});
+                }
+                collect();
+            }
+
+            /**
+             * @brief Schedules several unlinked objects for destruction with one lock and one collection.
+             * @tparam T Type of the objects.
+             * @param ptrs The objects, allocated with new, null entries are skipped.
+             */
+            template <typename T>
+            void retire(const std::vector<const T*>& ptrs) {
+                auto epoch = epoch_.load();
+                {
+                    std::lock_guard lock(retired_mutex_);
+                    for (auto* ptr : ptrs) {
+                        if (ptr) {
+                            retired_.push_back({const_cast<T*>(ptr), [](void* p) { delete static_cast<T*>(p); }, epoch});
+                        }
+                    }
+                }
+                collect();
+            }
+
+            /**
+             * @brief Tries to advance the epoch and destroys every object that became unreachable.
+             */
+            void collect() {
+                std::vector<retired_object> ready;
+                {
+                    std::lock_guard lock(retired_mutex_);
+                    try_advance();
+                    auto epoch = epoch_.load(std::memory_order_acquire);
+                    auto split = std::partition(retired_.begin(), retired_.end(),
+                                                [epoch](const retired_object& obj) { return obj.epoch_ + 2 > epoch; });
+                    ready.assign(split, retired_.end());
+                    retired_.erase(split, retired_.end());
+                }
+                // Destructors run unlocked, they may retire objects themselves.
+                for (auto& obj : ready) {
+                    obj.deleter_(obj.ptr_);
+                }
+            }
+
+        private:
+            /**
+             * @brief Per-thread reader state, padded to its own cache line.
+             */
+            struct alignas(64) thread_record {
+                std::atomic<std::uint64_t> state_{0}; ///< Pinned epoch shifted left by one, low bit set while pinned.
+                std::atomic<bool> in_use_{false}; ///< Whether a live thread owns the record.
+                thread_record* next_ = nullptr; ///< Next record in the registry.
+            };
+
+            /**
+             * @brief Thread-local owner of a record, releases it when the thread exits.
+             */
+            struct thread_local_state {
+                thread_record* record_; ///< The owned record.
+                unsigned nesting_ = 0; ///< Depth of nested pins.
+
+                ~thread_local_state() {
+                    record_->state_.store(0, std::memory_order_release);
+                    record_->in_use_.store(false, std::memory_order_release);
+                }
+            };
+
+            /**
+             * @brief An object waiting for reclamation.
+             */
+            struct retired_object {
+                void* ptr_; ///< The object.
+                void (*deleter_)(void*); ///< Destroys the object.
+                std::uint64_t epoch_; ///< Epoch at which the object was retired.
+            };
+
+            std::atomic<std::uint64_t> epoch_{0}; ///< The global epoch.
+            std::atomic<thread_record*> records_{nullptr}; ///< Registry of thread records, never shrinks.
+            std::mutex retired_mutex_; ///< Mutex for the retired list.
+            std::vector<retired_object> retired_; ///< Objects awaiting reclamation.
+
+            epoch_domain() = default;
+
+            /**
+             * @brief Gets the record of the calling thread, registering it on first use.
+             * @return The thread-local state.
+             */
+            thread_local_state& local_state() {
+                thread_local thread_local_state state{acquire_record()};
+                return state;
+            }
+
+            /**
+             * @brief Reuses a released record or registers a new one.
+             * @return A record owned by the calling thread.
+             */
+            thread_record* acquire_record() {
+                for (auto* rec = records_.load(std::memory_order_acquire); rec; rec = rec->next_) {
+                    bool expected = false;
+                    if (!rec->in_use_.load(std::memory_order_relaxed) &&
+                        rec->in_use_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                        return rec;
+                    }
+                }
+                auto* rec = new thread_record();
+                rec->in_use_.store(true, std::memory_order_relaxed);
+                rec->next_ = records_.load(std::memory_order_relaxed);
+                while (!records_.compare_exchange_weak(rec->next_, rec, std::memory_order_acq_rel)) {
+                }
+                return rec;
+            }
+
+            /**
+             * @brief Advances the epoch if every pinned reader has observed the current one.
+             */
+            void try_advance() {
+                auto epoch = epoch_.load();
+                for (auto* rec = records_.load(std::memory_order_acquire); rec; rec = rec->next_) {
+                    auto state = rec->state_.load();
+                    if ((state & 1) && (state >> 1) != epoch) {
+                        return;
+                    }
+                }
+                epoch_.store(epoch + 1);
+            }
+        };
+
+        /**
+         * @brief RAII pin of the reclamation epoch for the duration of a read.
+         */
+        class epoch_guard {
+        public:
+            epoch_guard() { epoch_domain::instance().pin(); }
+            ~epoch_guard() { epoch_domain::instance().unpin(); }
+            epoch_guard(const epoch_guard&) = delete;
+            epoch_guard& operator=(const epoch_guard&) = delete;
+        };
+
+#if MICROBUS_HAS_COROUTINES
+        /**
+         * @brief Intrusive node of a coroutine awaiting the next event of a topic, stored in its frame.
+         */
+        struct topic_waiter {
+            topic_waiter* next_ = nullptr; ///< Next waiter of the same topic.
+            void (*capture_)(topic_waiter&, void* args) = nullptr; ///< Copies the arguments, passed as a `std::tuple` of lvalue references.
+            void (*resume_)(topic_waiter&) = nullptr; ///< Resumes the awaiting coroutine.
+        };
+#endif
+
+        /**
+         * @brief Storage for a single interned topic and its subscribers.
+         *
+         * The subscriber list is an immutable snapshot: writers build a new list and swap it in,
+         * readers load the pointer inside an `epoch_guard` and iterate without locking.
+         */
+        struct topic_slot {
+            /**
+             * @brief Constructs a topic slot.
+             * @param name The name of the topic.
+             * @param id The dense index of the topic on its bus.
+             */
+            topic_slot(std::string name, std::size_t id) : name_(std::move(name)), id_(id) {}
+
+            ~topic_slot() {
+                delete handlers_.load(std::memory_order_relaxed);
+            }
+
+            std::string name_; ///< The name of the topic.
+            std::size_t id_; ///< The dense index of the topic on its bus.
+            std::atomic<const subscriber_list_base*> handlers_{nullptr}; ///< Current subscriber snapshot, nullptr when empty.
+            std::atomic<const void*> signature_{nullptr}; ///< Signature the topic is bound to, set once.
+#if MICROBUS_ENABLE_METRICS
+            mutable sharded_counters<2> counters_; ///< Published events and handler calls.
+#endif
+#if MICROBUS_HAS_COROUTINES
+            mutable std::atomic<topic_waiter*> waiters_{nullptr}; ///< Coroutines awaiting the next event, a lock-free stack.
+#endif
+        };
+
+        /**
+         * @brief The coroutines awaiting an event, detached from their topic when it is delivered.
+         *
+         * They receive a copy of the arguments before any subscriber runs, since the last subscriber
+         * may move from them, and are resumed once the subscribers have returned. Without coroutine
+         * support this is empty.
+         */
+        class waiting_coroutines {
+        public:
+            /**
+             * @brief Detaches the waiters of a topic and hands them the arguments.
+             * @tparam Ts Decayed argument types of the topic.
+             * @param slot The topic slot.
+             * @param args The arguments of the event.
+             */
+            template <typename... Ts>
+            waiting_coroutines([[maybe_unused]] const topic_slot& slot, [[maybe_unused]] Ts&... args) {
+#if MICROBUS_HAS_COROUTINES
+                if (pending(slot)) {
+                    list_ = slot.waiters_.exchange(nullptr, std::memory_order_acq_rel);
+                    std::tuple<Ts&...> refs(args...);
+                    for (auto* waiter = list_; waiter; waiter = waiter->next_) {
+                        waiter->capture_(*waiter, &refs);
+                    }
+                }
+#endif
+            }
+
+            waiting_coroutines(const waiting_coroutines&) = delete;
+            waiting_coroutines& operator=(const waiting_coroutines&) = delete;
+
+            ~waiting_coroutines() {
+#if MICROBUS_HAS_COROUTINES
+                while (list_) {
+                    // The node lives in the frame, which may be gone once resumed.
+                    auto* next = list_->next_;
+                    list_->resume_(*list_);
+                    list_ = next;
+                }
+#endif
+            }
+
+            /**
+             * @brief Checks whether coroutines await the next event of a topic.
+             * @param slot The topic slot.
+             * @return True if there are waiters, always false without coroutine support.
+             */
+            static bool pending([[maybe_unused]] const topic_slot& slot) {
+#if MICROBUS_HAS_COROUTINES
+                return slot.waiters_.load(std::memory_order_acquire) != nullptr;
+#else
+                return false;
+#endif
+            }
+
+#if MICROBUS_HAS_COROUTINES
+        private:
+            topic_waiter* list_ = nullptr; ///< The detached waiters.
+#endif
+        };
+
+        /**
+         * @brief Immutable snapshot of the interned topics of a bus.
+         */
+        struct topic_directory {
+            std::unordered_map<std::string, topic_slot*> by_name_; ///< Topic slots by name.
+            std::vector<topic_slot*> by_id_; ///< Dense slot table indexed by topic ID.
+        };
+
+        /**
+         * @brief Lock of the subscriber snapshots of the topics hashed to it, on its own cache line.
+         */
+        struct alignas(64) bus_shard {
+            std::mutex mutex_; ///< Serializes subscription changes of the shard's topics.
+        };
+
+        /**
+         * @brief Splits a topic name or pattern into its '.' separated segments.
+         * @param name The topic name or pattern.
+         * @return Views of the segments.
+         */
+        inline std::vector<std::string_view> topic_segments(std::string_view name) {
+            std::vector<std::string_view> segments;
+            std::size_t begin = 0;
+            while (true) {
+                auto end = name.find('.', begin);
+                segments.push_back(name.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin));
+                if (end == std::string_view::npos) {
+                    return segments;
+                }
+                begin = end + 1;
+            }
+        }
+
+        /**
+         * @brief Checks a pattern for wildcards that do not span a whole segment.
+         * @param pattern The subscription pattern.
+         * @throws std::invalid_argument If `*` or `#` is part of a longer segment.
+         */
+        inline void check_pattern(const std::string& pattern) {
+            for (auto segment : topic_segments(pattern)) {
+                if (segment.size() > 1 && segment.find_first_of("*#") != std::string_view::npos) {
+                    throw std::invalid_argument("microbus: wildcards must span a whole segment of pattern '" + pattern + "'");
+                }
+            }
+        }
+
+        /**
+         * @brief Matches topic segments against pattern segments.
+         * @param pattern The pattern segments.
+         * @param name The topic segments.
+         * @return True if `*` and `#` can be expanded to the topic.
+         */
+        inline bool segments_match(const std::string_view* pattern, const std::string_view* pattern_end,
+                                   const std::string_view* name, const std::string_view* name_end) {
+            for (; pattern != pattern_end; ++pattern, ++name) {
+                if (*pattern == "#") {
+                    for (auto* rest = name; ; ++rest) {
+                        if (segments_match(pattern + 1, pattern_end, rest, name_end)) {
+                            return true;
+                        }
+                        if (rest == name_end) {
+                            return false;
+                        }
+                    }
+                }
+                if (name == name_end || (*pattern != "*" && *pattern != *name)) {
+                    return false;
+                }
+            }
+            return name == name_end;
+        }
+
+        /**
+         * @brief Checks whether a topic name matches a subscription pattern.
+         *
+         * `*` matches exactly one segment and `#` any number of segments, including none.
+         *
+         * @param pattern The subscription pattern.
+         * @param name The topic name.
+         * @return True if the pattern matches the name.
+         */
+        inline bool topic_matches(std::string_view pattern, std::string_view name) {
+            auto p = topic_segments(pattern);
+            auto n = topic_segments(name);
+            return segments_match(p.data(), p.data() + p.size(), n.data(), n.data() + n.size());
+        }
+
+        /**
+         * @brief A subscription to every topic whose name matches a pattern.
+         *
+         * The handler is compiled into the subscriber snapshot of each matching topic, so
+         * triggering a topic never looks at patterns.
+         */
+        struct pattern_subscription_base {
+            /**
+             * @brief Constructs a pattern subscription.
+             * @param id The subscription ID.
+             * @param pattern The subscription pattern.
+             * @param signature The signature identity of the handler.
+             */
+            pattern_subscription_base(int id, std::string pattern, const void* signature)
+                : id_(id), pattern_(std::move(pattern)), signature_(signature) {}
+
+            virtual ~pattern_subscription_base() = default;
+
+            /**
+             * @brief Adds the handler to a topic's subscriber snapshot, the caller must hold the shard lock.
+             *
+             * The handler goes last, or just before a last subscriber that takes ownership of the arguments.
+             *
+             * @param current The current snapshot of the topic, may be nullptr.
+             * @return The snapshot to publish, current if the handler was appended in place.
+             */
+            [[nodiscard]] virtual const subscriber_list_base* attach(const subscriber_list_base* current) const = 0;
+
+            int id_; ///< The subscription ID.
+            std::string pattern_; ///< The subscription pattern.
+            const void* signature_; ///< Signature of the topics the handler accepts.
+            std::vector<topic_slot*> topics_; ///< The topics the handler was added to.
+        };
+
+        /**
+         * @brief A pattern subscription for one topic signature.
+         * @tparam Ts Decayed argument types of the matching topics.
+         */
+        template <typename... Ts>
+        struct pattern_subscription final : pattern_subscription_base {
+            /**
+             * @brief Constructs a pattern subscription.
+             * @param id The subscription ID.
+             * @param pattern The subscription pattern.
+             * @param handler The handler, shared by every matching topic.
+             */
+            pattern_subscription(int id, std::string pattern, inline_handler<Ts...> handler)
+                : pattern_subscription_base(id, std::move(pattern), signature_of<Ts...>()), handler_(std::move(handler)) {}
+
+            [[nodiscard]] const subscriber_list_base* attach(const subscriber_list_base* current) const override {
+                using list_type = subscriber_list<Ts...>;
+#if MICROBUS_ENABLE_METRICS
+                typename list_type::entry subscriber{id_, handler_, std::make_shared<latency_histogram>()};
+#else
+                typename list_type::entry subscriber{id_, handler_};
+#endif
+                // Only the shard's writer mutates a published snapshot, and only past the prefix readers see.
+                auto* list = const_cast<list_type*>(static_cast<const list_type*>(current));
+                const auto* owner = list ? list->last_live() : nullptr;
+                if (owner && owner->handler_.shareable()) {
+                    owner = nullptr;
+                }
+                if (list && !owner && !list->full()) {
+                    list->append(std::move(subscriber));
+                    return list;
+                }
+                auto next = list ? list->compacted(1, owner ? owner->id_ : -1) : std::make_unique<list_type>();
+                next->append(std::move(subscriber));
+                if (owner) {
+                    next->append(*owner);
+                }
+                return next.release();
+            }
+
+            inline_handler<Ts...> handler_; ///< Calls the subscribed callable.
+        };
+
+        /**
+         * @brief Trie of pattern subscriptions keyed by segment, wildcards are ordinary children.
+         *
+         * Looking up the patterns of a topic walks one path per wildcard branch, so it costs
+         * O(segments) for exact patterns instead of testing every pattern.
+         */
+        class pattern_trie {
+        public:
+            /**
+             * @brief Adds a subscription under its pattern.
+             * @param subscription The subscription.
+             */
+            void insert(pattern_subscription_base* subscription) {
+                auto* current = &root_;
+                for (auto segment : topic_segments(subscription->pattern_)) {
+                    auto& child = current->children_[std::string(segment)];
+                    if (!child) {
+                        child = std::make_unique<node>();
+                    }
+                    current = child.get();
+                }
+                current->subscriptions_.push_back(subscription);
+            }
+
+            /**
+             * @brief Removes a subscription and prunes the nodes it leaves empty.
+             * @param subscription The subscription.
+             */
+            void erase(const pattern_subscription_base* subscription) {
+                auto segments = topic_segments(subscription->pattern_);
+                erase(root_, segments.data(), segments.data() + segments.size(), subscription);
+            }
+
+            /**
+             * @brief Finds the subscriptions whose pattern matches a topic name.
+             * @param name The topic name.
+             * @return The matching subscriptions in subscription order.
+             */
+            [[nodiscard]] std::vector<pattern_subscription_base*> match(std::string_view name) const {
+                std::vector<pattern_subscription_base*> out;
+                auto segments = topic_segments(name);
+                match(root_, segments.data(), segments.data() + segments.size(), out);
+                // Patterns such as "a.#.#" reach a subscription along several paths.
+                std::sort(out.begin(), out.end(), [](auto* a, auto* b) { return a->id_ < b->id_; });
+                out.erase(std::unique(out.begin(), out.end()), out.end());
+                return out;
+            }
+
+            /**
+             * @brief Removes every subscription.
+             */
+            void clear() {
+                root_ = node();
+            }
+
+        private:
+            /**
+             * @brief A pattern segment with the subscriptions whose pattern ends there.
+             */
+            struct node {
+                std::unordered_map<std::string, std::unique_ptr<node>> children_; ///< Next segments, including `*` and `#`.
+                std::vector<pattern_subscription_base*> subscriptions_; ///< Subscriptions whose pattern ends at this node.
+            };
+
+            static bool erase(node& current, const std::string_view* segment, const std::string_view* end,
+                              const pattern_subscription_base* subscription) {
+                if (segment == end) {
+                    auto& subs = current.subscriptions_;
+                    subs.erase(std::remove(subs.begin(), subs.end(), subscription), subs.end());
+                } else if (auto it = current.children_.find(std::string(*segment)); it != current.children_.end()) {
+                    if (erase(*it->second, segment + 1, end, subscription)) {
+                        current.children_.erase(it);
+                    }
+                }
+                return current.subscriptions_.empty() && current.children_.empty();
+            }
+
+            static void match(const node& current, const std::string_view* segment, const std::string_view* end,
+                              std::vector<pattern_subscription_base*>& out) {
+                if (auto hash = current.children_.find("#"); hash != current.children_.end()) {
+                    for (auto* rest = segment; ; ++rest) {
+                        match(*hash->second, rest, end, out);
+                        if (rest == end) {
+                            break;
+                        }
+                    }
+                }
+                if (segment == end) {
+                    out.insert(out.end(), current.subscriptions_.begin(), current.subscriptions_.end());
+                    return;
+                }
+                if (auto exact = current.children_.find(std::string(*segment)); exact != current.children_.end()) {
+                    match(*exact->second, segment + 1, end, out);
+                }
+                if (auto star = current.children_.find("*"); star != current.children_.end()) {
+                    match(*star->second, segment + 1, end, out);
+                }
+            }
+
+            node root_; ///< The empty pattern prefix.
+        };
+
+        /**
+         * @brief Runs a callable on a worker of a loop once a delay has elapsed, defined after `event_loop`.
+         * @tparam Fn Type of the callable, invocable without arguments.
+         * @param loop The loop.
+         * @param delay Time before the callable is queued.
+         * @param fn The callable.
+         * @return False if the loop is stopping.
+         */
+        template <typename Fn>
+        bool post_after(event_loop& loop, std::chrono::nanoseconds delay, Fn&& fn);
+
+        /**
+         * @brief An event whose subscribers are called in parallel, shared by the tasks that call them.
+         * @tparam Ts Decayed argument types of the topic.
+         */
+        template <typename... Ts>
+        struct fan_out {
+            /**
+             * @brief Packs the arguments of the event.
+             * @tparam Params Types of the passed arguments, converted to `Ts...`.
+             * @param bus The bus owning the topic, kept alive until the last task has finished.
+             * @param slot The topic slot.
+             * @param memory Allocates the shared state of the completion future.
+             * @param params The arguments.
+             */
+            template <typename... Params>
+            fan_out(std::shared_ptr<event_bus> bus, const topic_slot* slot, std::pmr::memory_resource* memory, Params&&... params)
+                    : bus_(std::move(bus)), slot_(slot), args_(std::forward<Params>(params)...),
+                      done_(std::allocator_arg, std::pmr::polymorphic_allocator<std::byte>(memory)) {}
+
+            /**
+             * @brief Keeps the first exception thrown by a handler for the completion future.
+             * @param error The exception.
+             */
+            void fail(std::exception_ptr error) {
+                if (!failed_.exchange(true, std::memory_order_acq_rel)) {
+                    error_ = std::move(error);
+                }
+            }
+
+            /**
+             * @brief Releases one reference, the last one completes the future.
+             */
+            void finish() {
+                if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    settle();
+                }
+            }
+
+            /**
+             * @brief Counts one target as called, the last one completes the future without waiting for
+             *        tasks that are still queued but have nothing left to claim.
+             */
+            void called() {
+                if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    settle();
+                }
+            }
+
+            /**
+             * @brief Completes the future, once.
+             */
+            void settle() {
+                if (settled_.exchange(true, std::memory_order_acq_rel)) {
+                    return;
+                }
+                if (failed_.load(std::memory_order_acquire)) {
+                    done_.set_exception(error_);
+                } else {
+                    done_.set_value();
+                }
+            }
+
+            std::shared_ptr<event_bus> bus_; ///< The bus owning the topic.
+            const topic_slot* slot_; ///< The topic slot.
+            std::tuple<Ts...> args_; ///< The arguments, shared by every subscriber.
+            std::vector<std::pair<std::size_t, int>> targets_; ///< Slot index and subscription ID of the subscribers to call.
+            std::atomic<std::size_t> next_{0}; ///< Index of the next target to claim.
+            std::atomic<std::size_t> pending_{1}; ///< The trigger and the tasks that have not finished yet.
+            std::atomic<std::size_t> remaining_{0}; ///< Targets that have not been called yet.
+            std::atomic<bool> settled_{false}; ///< Whether the future was completed.
+            std::atomic<bool> failed_{false}; ///< Whether `error_` was set.
+            std::exception_ptr error_; ///< The first exception a handler threw.
+            std::promise<void> done_; ///< Completed once every task has finished.
+        };
+
+        /**
+         * @brief A reference of a queued task to its fan-out, released when the task is run or discarded.
+         * @tparam Ts Decayed argument types of the topic.
+         */
+        template <typename... Ts>
+        class fan_out_part {
+        public:
+            /**
+             * @brief Takes a reference to a fan-out.
+             * @param state The fan-out.
+             */
+            explicit fan_out_part(std::shared_ptr<fan_out<Ts...>> state) : state_(std::move(state)) {
+                state_->pending_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            fan_out_part(fan_out_part&& other) noexcept = default;
+            fan_out_part& operator=(fan_out_part&&) = delete;
+
+            ~fan_out_part() {
+                if (state_) {
+                    state_->finish();
+                }
+            }
+
+            /**
+             * @brief Gets the fan-out.
+             * @return The fan-out.
+             */
+            [[nodiscard]] fan_out<Ts...>& state() const {
+                return *state_;
+            }
+
+        private:
+            std::shared_ptr<fan_out<Ts...>> state_; ///< The fan-out, null once moved from.
+        };
+
+        /**
+         * @brief Type-erased receiver of the replies to one request.
+         */
+        struct reply_sink_base {
+            virtual ~reply_sink_base() = default;
+
+            /**
+             * @brief Completes the request with the replies received so far, later replies are rejected.
+             */
+            virtual void expire() = 0;
+
+            /**
+             * @brief Destroys the receiver and frees its memory.
+             */
+            virtual void destroy() = 0;
+        };
+
+        /**
+         * @brief Receiver of the replies to one request.
+         * @tparam R Type of a reply.
+         */
+        template <typename R>
+        struct reply_sink : reply_sink_base {
+            /**
+             * @brief Hands over a reply.
+             * @param value The reply.
+             * @return False if the request no longer takes replies.
+             */
+            virtual bool offer(R&& value) = 0;
+        };
+
+        /**
+         * @brief Correlation table of the pending requests of a bus.
+         *
+         * A correlation ID packs a slot index with the slot's generation, which is bumped when the slot
+         * is recycled, so stale IDs are recognized. Each slot counts the reply tokens referring to it
+         * and recycles itself when the last one is released. Opening and closing a request pop and push
+         * a lock-free free list; only a table without free slots takes a mutex to add a chunk.
+         */
+        class reply_table {
+        public:
+            static constexpr std::size_t chunk_size = 256; ///< Slots added at a time.
+            static constexpr std::size_t max_chunks = 256; ///< Chunks at most, bounding the pending requests.
+
+            reply_table() = default;
+            reply_table(const reply_table&) = delete;
+            reply_table& operator=(const reply_table&) = delete;
+
+            ~reply_table() {
+                for (auto& chunk : chunks_) {
+                    delete[] chunk.load(std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * @brief Takes a free slot for a request, holding one reference for the caller.
+             * @param sink The receiver of the replies, destroyed once the slot is recycled.
+             * @return The correlation ID.
+             * @throws std::length_error If `chunk_size * max_chunks` requests are pending.
+             */
+            std::uint64_t open(reply_sink_base* sink) {
+                auto index = pop();
+                auto& target = at(index);
+                target.sink_.store(sink, std::memory_order_relaxed);
+                auto generation = target.state_.load(std::memory_order_relaxed) >> 32;
+                target.state_.store((generation << 32) | 1, std::memory_order_release);
+                return (generation << 32) | index;
+            }
+
+            /**
+             * @brief Takes a reference to a slot known only by its correlation ID.
+             * @param id The correlation ID.
+             * @return False if the request is no longer pending.
+             */
+            bool acquire(std::uint64_t id) {
+                auto index = static_cast<std::uint32_t>(id);
+                if (index >= size_.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                auto& target = at(index);
+                auto state = target.state_.load(std::memory_order_acquire);
+                while ((state >> 32) == (id >> 32) && (state & 0xffffffffu) != 0) {
+                    if (target.state_.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /**
+             * @brief Takes another reference to a slot the caller holds a reference to.
+             * @param id The correlation ID.
+             */
+            void retain(std::uint64_t id) {
+                at(static_cast<std::uint32_t>(id)).state_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Releases a reference, the last one expires the request and recycles the slot.
+             * @param id The correlation ID.
+             */
+            void release(std::uint64_t id) {
+                auto index = static_cast<std::uint32_t>(id);
+                auto& target = at(index);
+                auto state = target.state_.load(std::memory_order_relaxed);
+                while (true) {
+                    // Dropping the last reference also bumps the generation, so `acquire` cannot revive the slot.
+                    auto next = (state & 0xffffffffu) == 1 ? ((state >> 32) + 1) << 32 : state - 1;
+                    if (target.state_.compare_exchange_weak(state, next, std::memory_order_acq_rel)) {
+                        break;
+                    }
+                }
+                if ((state & 0xffffffffu) == 1) {
+                    auto* sink = target.sink_.exchange(nullptr, std::memory_order_acquire);
+                    sink->expire();
+                    sink->destroy();
+                    push(index);
+                }
+            }
+
+            /**
+             * @brief Gets the receiver of a slot the caller holds a reference to.
+             * @param id The correlation ID.
+             * @return The receiver.
+             */
+            [[nodiscard]] reply_sink_base* sink(std::uint64_t id) const {
+                return at(static_cast<std::uint32_t>(id)).sink_.load(std::memory_order_acquire);
+            }
+
+        private:
+            /**
+             * @brief A correlation slot.
+             */
+            struct slot {
+                std::atomic<std::uint64_t> state_{0}; ///< Generation in the upper half, reference count in the lower half.
+                std::atomic<reply_sink_base*> sink_{nullptr}; ///< The receiver of the pending request.
+                std::atomic<std::uint32_t> next_{0}; ///< Free list link, one past the next free index, zero at the end.
+            };
+
+            [[nodiscard]] slot& at(std::uint32_t index) const {
+                return chunks_[index / chunk_size].load(std::memory_order_acquire)[index % chunk_size];
+            }
+
+            std::uint32_t pop() {
+                auto head = free_.load(std::memory_order_acquire);
+                while (true) {
+                    auto top = static_cast<std::uint32_t>(head);
+                    if (top == 0) {
+                        grow();
+                        head = free_.load(std::memory_order_acquire);
+                        continue;
+                    }
+                    // The tag in the upper half changes on every pop, which defeats ABA.
+                    auto next = at(top - 1).next_.load(std::memory_order_relaxed);
+                    if (free_.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | next, std::memory_order_acq_rel)) {
+                        return top - 1;
+                    }
+                }
+            }
+
+            void push(std::uint32_t index) {
+                auto head = free_.load(std::memory_order_relaxed);
+                do {
+                    at(index).next_.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+                } while (!free_.compare_exchange_weak(head, (head & ~std::uint64_t{0xffffffffu}) | (index + 1),
+                                                      std::memory_order_acq_rel));
+            }
+
+            void grow() {
+                std::unique_lock lock(grow_mutex_);
+                if (static_cast<std::uint32_t>(free_.load(std::memory_order_acquire)) != 0) {
+                    return;
+                }
+                auto size = size_.load(std::memory_order_relaxed);
+                if (size == chunk_size * max_chunks) {
+                    throw std::length_error("microbus: too many pending requests");
+                }
+                auto* chunk = new slot[chunk_size];
+                for (std::size_t i = 0; i < chunk_size; ++i) {
+                    chunk[i].state_.store(std::uint64_t{1} << 32, std::memory_order_relaxed);
+                }
+                chunks_[size / chunk_size].store(chunk, std::memory_order_release);
+                size_.store(size + chunk_size, std::memory_order_release);
+                for (auto i = chunk_size; i-- > 0;) {
+                    push(static_cast<std::uint32_t>(size + i));
+                }
+            }
+
+            std::atomic<slot*> chunks_[max_chunks] = {}; ///< Slot chunks, never moved or freed before the table.
+            std::atomic<std::uint32_t> size_{0}; ///< Number of slots in the published chunks.
+            std::atomic<std::uint64_t> free_{0}; ///< Free list head, an ABA tag in the upper half and one past the index in the lower half.
+            std::mutex grow_mutex_; ///< Serializes adding chunks.
+        };
+
+        /**
+         * @brief Receiver of a request that completes with its first reply.
+         * @tparam R Type of the reply.
+         */
+        template <typename R>
+        class single_reply final : public reply_sink<R> {
+        public:
+            /**
+             * @brief Constructs the receiver.
+             * @param memory Allocates the receiver and the state of its future.
+             */
+            explicit single_reply(std::pmr::memory_resource* memory)
+                    : memory_(memory), promise_(std::allocator_arg, std::pmr::polymorphic_allocator<std::byte>(memory)) {}
+
+            /**
+             * @brief Gets the future of the request.
+             * @return The future, broken if the request expires without a reply.
+             */
+            std::future<R> future() {
+                return promise_.get_future();
+            }
+
+            bool offer(R&& value) override {
+                if (done_.exchange(true, std::memory_order_acq_rel)) {
+                    return false;
+                }
+                promise_.set_value(std::move(value));
+                return true;
+            }
+
+            void expire() override {
+                done_.store(true, std::memory_order_release);
+            }
+
+            void destroy() override {
+                auto* memory = memory_;
+                this->~single_reply();
+                memory->deallocate(this, sizeof(single_reply), alignof(single_reply));
+            }
+
+        private:
+            std::pmr::memory_resource* memory_; ///< Allocated the receiver.
+            std::atomic<bool> done_{false}; ///< Whether the request was answered or expired.
+            std::promise<R> promise_; ///< Completed by the first reply.
+        };
+
+        /**
+         * @brief Receiver of a request that collects a number of replies.
+         * @tparam R Type of a reply.
+         */
+        template <typename R>
+        class gathered_replies final : public reply_sink<R> {
+        public:
+            /**
+             * @brief Constructs the receiver.
+             * @param memory Allocates the receiver and the state of its future.
+             * @param count Number of replies that complete the request.
+             */
+            gathered_replies(std::pmr::memory_resource* memory, std::size_t count)
+                    : memory_(memory), count_(count), promise_(std::allocator_arg, std::pmr::polymorphic_allocator<std::byte>(memory)) {}
+
+            /**
+             * @brief Gets the future of the request.
+             * @return The future.
+             */
+            std::future<std::vector<R>> future() {
+                return promise_.get_future();
+            }
+
+            bool offer(R&& value) override {
+                std::unique_lock lock(mutex_);
+                if (done_) {
+                    return false;
+                }
+                values_.push_back(std::move(value));
+                if (values_.size() >= count_) {
+                    complete();
+                }
+                return true;
+            }
+
+            void expire() override {
+                std::unique_lock lock(mutex_);
+                if (!done_) {
+                    complete();
+                }
+            }
+
+            void destroy() override {
+                auto* memory = memory_;
+                this->~gathered_replies();
+                memory->deallocate(this, sizeof(gathered_replies), alignof(gathered_replies));
+            }
+
+        private:
+            void complete() {
+                done_ = true;
+                promise_.set_value(std::move(values_));
+            }
+
+            std::pmr::memory_resource* memory_; ///< Allocated the receiver.
+            std::size_t count_; ///< Number of replies that complete the request.
+            std::mutex mutex_; ///< Serializes concurrent replies.
+            bool done_ = false; ///< Whether the future was completed.
+            std::vector<R> values_; ///< Replies received so far.
+            std::promise<std::vector<R>> promise_; ///< Completed with the replies.
+        };
+    }
+
+    /**
+     * @brief A token for answering a request, passed to the subscribers of a request topic as its first argument.
+     *
+     * Copies refer to the same request, which stays pending while any copy is alive, so a handler
+     * can keep one to reply later from another thread. A request without a timeout completes once
+     * every copy is gone. A token must not outlive its bus.
+     *
+     * @tparam R Type of the reply.
+     */
+    template <typename R>
+    class reply {
+    public:
+        reply() = default;
+
+        reply(const reply& other) : table_(other.table_), id_(other.id_) {
+            if (table_) {
+                table_->retain(id_);
+            }
+        }
+
+        reply(reply&& other) noexcept : table_(std::exchange(other.table_, nullptr)), id_(other.id_) {}
+
+        reply& operator=(reply other) noexcept {
+            std::swap(table_, other.table_);
+            std::swap(id_, other.id_);
+            return *this;
+        }
+
+        ~reply() {
+            if (table_) {
+                table_->release(id_);
+            }
+        }
+
+        /**
+         * @brief Answers the request.
+         * @param value The reply.
+         * @return False if the request already completed or expired, or the token is empty.
+         */
+        bool send(R value) const {
+            return table_ && static_cast<detail::reply_sink<R>*>(table_->sink(id_))->offer(std::move(value));
+        }
+
+        /**
+         * @brief Gets the correlation ID of the request, unique among the pending requests of the bus.
+         * @return The ID.
+         */
+        [[nodiscard]] std::uint64_t correlation_id() const {
+            return id_;
+        }
+
+        /**
+         * @brief Checks whether the token refers to a request.
+         * @return False for a default-constructed or moved-from token.
+         */
+        [[nodiscard]] bool valid() const {
+            return table_ != nullptr;
+        }
+
+    private:
+        friend class event_bus;
+
+        /**
+         * @brief Takes over the reference the caller holds to a correlation slot.
+         * @param table The correlation table of the bus.
+         * @param id The correlation ID.
+         */
+        reply(detail::reply_table* table, std::uint64_t id) : table_(table), id_(id) {}
+
+        detail::reply_table* table_ = nullptr; ///< The correlation table of the bus, null if empty.
+        std::uint64_t id_ = 0; ///< The correlation ID.
+    };
+
+    /**
+     * @brief Options of `event_bus::gather`.
+     */
+    struct gather_options {
+        std::size_t count = SIZE_MAX; ///< Replies that complete the gather, by default it completes once every subscriber has dropped its token.
+        std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero(); ///< Time after which the gather completes with the replies so far, zero for none.
+        event_loop* timer = nullptr; ///< Loop whose timer wheel enforces the timeout, `gather` throws without one when a timeout is set.
+    };
+
+    /**
+     * @brief A handle to an interned topic, resolved once and used on the hot path.
+     *
+     * A handle points straight at the topic slot of the bus that created it,
+     * so triggering or enqueueing through it never hashes the topic name.
+     * Handles stay valid for the lifetime of the bus, including across `clear()`.
+     *
+     * @tparam Args Argument types of the topic.
+     */
+    template <typename... Args>
+    class topic_handle {
+        static_assert((std::is_same_v<Args, std::decay_t<Args>> && ...),
+                      "topic_handle arguments must be value types");
+
+    public:
+        topic_handle() = default;
+
+        /**
+         * @brief Checks whether the handle refers to a topic.
+         * @return True if the handle was obtained from an event bus.
+         */
+        [[nodiscard]] bool valid() const { return slot_ != nullptr; }
+
+        /**
+         * @brief Gets the dense index of the topic on its bus.
+         * @return The topic ID.
+         */
+        [[nodiscard]] std::size_t id() const { return slot_->id_; }
+
+        /**
+         * @brief Gets the name of the topic.
+         * @return The topic name.
+         */
+        [[nodiscard]] const std::string& name() const { return slot_->name_; }
+
+    private:
+        friend class event_bus;
+        friend class event_loop;
+
+        /**
+         * @brief Constructs a handle for the given topic slot.
+         * @param slot The topic slot.
+         */
+        explicit topic_handle(detail::topic_slot* slot) : slot_(slot) {}
+
+        detail::topic_slot* slot_ = nullptr; ///< The referenced topic slot.
+    };
+
+    /**
+     * @brief A refcounted read-only view of a byte buffer.
+     *
+     * Copies share the underlying storage, so a large payload can be handed to every subscriber
+     * and through the event loop without copying its contents.
+     */
+    class shared_buffer {
+    public:
+        shared_buffer() = default;
+
+        /**
+         * @brief Constructs a view of memory kept alive by an owner.
+         * @param owner Keeps the memory alive while any view of it exists.
+         * @param data The first byte of the view.
+         * @param size Number of bytes in the view.
+         */
+        shared_buffer(std::shared_ptr<const void> owner, const void* data, std::size_t size)
+                : owner_(std::move(owner)), data_(static_cast<const std::byte*>(data)), size_(size) {}
+
+        /**
+         * @brief Takes ownership of a contiguous container, moving it instead of copying its elements.
+         * @tparam Container Type of the container, for example `std::vector<char>` or `std::string`.
+         * @param container The container.
+         * @return A view of the whole container.
+         */
+        template <typename Container>
+        static shared_buffer adopt(Container&& container) {
+            auto owner = std::make_shared<const std::decay_t<Container>>(std::forward<Container>(container));
+            const auto* data = std::data(*owner);
+            return shared_buffer(owner, data, std::size(*owner) * sizeof(*data));
+        }
+
+        /**
+         * @brief Gets the viewed bytes.
+         * @return Pointer to the first byte.
+         */
+        [[nodiscard]] const std::byte* data() const { return data_; }
+
+        /**
+         * @brief Gets the size of the view.
+         * @return Number of bytes.
+         */
+        [[nodiscard]] std::size_t size() const { return size_; }
+
+        /**
+         * @brief Checks whether the view is empty.
+         * @return True if the view has no bytes.
+         */
+        [[nodiscard]] bool empty() const { return size_ == 0; }
+
+        [[nodiscard]] const std::byte* begin() const { return data_; }
+        [[nodiscard]] const std::byte* end() const { return data_ + size_; }
+
+        /**
+         * @brief Gets a part of the view that shares the same storage.
+         * @param offset First byte of the part.
+         * @param count Maximum number of bytes, clamped to the end of the view.
+         * @return The part.
+         * @throws std::out_of_range If the offset is past the end of the view.
+         */
+        [[nodiscard]] shared_buffer slice(std::size_t offset, std::size_t count = SIZE_MAX) const {
+            if (offset > size_) {
+                throw std::out_of_range("microbus: shared_buffer slice offset out of range");
+            }
+            return shared_buffer(owner_, data_ + offset, std::min(count, size_ - offset));
+        }
+
+    private:
+        std::shared_ptr<const void> owner_; ///< Keeps the viewed memory alive.
+        const std::byte* data_ = nullptr; ///< The first viewed byte.
+        std::size_t size_ = 0; ///< Number of viewed bytes.
+    };
+
+#if MICROBUS_HAS_COROUTINES
+    /**
+     * @brief Awaitable that suspends a coroutine until the next event of a topic.
+     *
+     * The awaitable links itself into the topic from the coroutine frame, so awaiting does not
+     * allocate. The arguments of the event are copied before any subscriber runs, and the coroutine
+     * is resumed after the subscribers, on the triggering thread or, when created by
+     * `event_loop::next`, on a worker of the loop. The bus must outlive the suspension, and the
+     * coroutine must not be destroyed while it waits.
+     *
+     * `co_await` yields nothing for a topic without arguments, the argument itself for one argument
+     * and a `std::tuple` otherwise.
+     *
+     * @tparam Args Argument types of the topic.
+     */
+    template <typename... Args>
+    class next_event : private detail::topic_waiter {
+    public:
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            handle_ = handle;
+            capture_ = &capture;
+            resume_ = &resume;
+            next_ = slot_->waiters_.load(std::memory_order_relaxed);
+            // Once published, the node may be resumed and destroyed at any time.
+            while (!slot_->waiters_.compare_exchange_weak(next_, this, std::memory_order_release, std::memory_order_relaxed)) {
+            }
+        }
+
+        decltype(auto) await_resume() {
+            if constexpr (sizeof...(Args) == 1) {
+                return std::move(std::get<0>(*value_));
+            } else if constexpr (sizeof...(Args) > 1) {
+                return std::move(*value_);
+            }
+        }
+
+    private:
+        friend class event_bus;
+        friend class event_loop;
+
+        /**
+         * @brief Constructs the awaitable.
+         * @param slot The topic slot.
+         * @param schedule Resumes the coroutine elsewhere, nullptr to resume it on the triggering thread.
+         * @param context Passed to `schedule`.
+         */
+        explicit next_event(const detail::topic_slot& slot, void (*schedule)(void*, std::coroutine_handle<>) = nullptr, void* context = nullptr)
+                : slot_(&slot), schedule_(schedule), context_(context) {}
+
+        static void capture(detail::topic_waiter& waiter, void* args) {
+            static_cast<next_event&>(waiter).value_.emplace(*static_cast<std::tuple<Args&...>*>(args));
+        }
+
+        static void resume(detail::topic_waiter& waiter) {
+            auto& self = static_cast<next_event&>(waiter);
+            if (self.schedule_) {
+                self.schedule_(self.context_, self.handle_);
+            } else {
+                self.handle_.resume();
+            }
+        }
+
+        const detail::topic_slot* slot_; ///< The awaited topic.
+        void (*schedule_)(void*, std::coroutine_handle<>); ///< Resumes the coroutine elsewhere, may be nullptr.
+        void* context_; ///< Argument of `schedule_`.
+        std::coroutine_handle<> handle_; ///< The suspended coroutine.
+        std::optional<std::tuple<Args...>> value_; ///< The arguments of the event, set before resumption.
+    };
+
+    /**
+     * @brief Return type of coroutine event handlers.
+     *
+     * The coroutine starts running inside the trigger like any handler and continues on its own
+     * after its first suspension, for instance on a loop worker after `co_await loop.schedule()`.
+     * Its frame is freed when it finishes. Take arguments by value, since references die with the
+     * trigger, and subscribe a plain lambda that calls a coroutine function rather than a capturing
+     * coroutine lambda, whose captures are not part of the frame. An exception leaving the coroutine
+     * calls `std::terminate`, like one leaving a thread function.
+     */
+    struct async_handler {
+        struct promise_type {
+            async_handler get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+#endif
+
+    /**
+     * @brief A class representing an event bus for managing subscriptions and event notifications.
+     *
+     * Subscriber lists are published as immutable snapshots, so triggering never takes the bus mutex
+     * and handlers may subscribe or unsubscribe on their own bus. A trigger that is already running
+     * keeps delivering to the snapshot it started with.
+     */
+    class event_bus : public std::enable_shared_from_this<event_bus> {
+    public:
+        template <typename... Args>
+        using event_handler = std::function<void(Args...)>;
+
+        /**
+         * @brief Constructs a bus with `MICROBUS_BUS_SHARDS` subscription shards.
+         */
+        event_bus() : event_bus(MICROBUS_BUS_SHARDS) {}
+
+        /**
+         * @brief Constructs a bus whose topics are spread over independently locked subscription shards.
+         *
+         * Subscribing and unsubscribing lock only the shard of the topic, so subscription churn on one
+         * topic does not serialize with changes to topics of other shards. Triggers never lock.
+         *
+         * @param shard_count Number of shards, at least one.
+         * @param memory Allocates the arguments shared by executor-bound subscribers, nullptr for the built-in per-thread slab pool.
+         */
+        explicit event_bus(std::size_t shard_count, std::pmr::memory_resource* memory = nullptr)
+            : shards_(std::make_unique<detail::bus_shard[]>(std::max<std::size_t>(shard_count, 1))),
+              shard_count_(std::max<std::size_t>(shard_count, 1)), memory_(detail::resource_or_pool(memory)) {}
+
+        event_bus(const event_bus&) = delete;
+        event_bus& operator=(const event_bus&) = delete;
+
+        /**
+         * @brief Destroys the bus, no trigger may be running on it.
+         */
+        ~event_bus() {
+            delete directory_.load(std::memory_order_relaxed);
+            detail::epoch_domain::instance().collect();
+        }
+
+        /**
+         * @brief Topic on which the `dead_letter` and `retry` policies publish a `handler_error`, interned with `topic<handler_error>`.
+         */
+        static constexpr const char* dead_letter_topic = "microbus.dead_letter";
+
+        /**
+         * @brief Sets what the bus does when an event handler throws, before the bus is shared with other threads.
+         *
+         * Under any policy but `propagate` every subscriber of an event is called even if an earlier
+         * one throws. `retry` calls only the failed subscriber again, from a worker of the retry loop,
+         * with a copy of the arguments; it needs copyable arguments and a bus owned by a `shared_ptr`,
+         * otherwise the event becomes a dead letter at once. Handlers on an executor report their
+         * exceptions to the executor. Errors of dead letter handlers are only logged.
+         *
+         * @param options The error handling.
+         */
+        void set_error_options(error_options options) {
+            errors_ = std::move(options);
+        }
+
+        /**
+         * @brief Interns a topic and returns a handle to it.
+         *
+         * The first call binds the topic to the signature `Args...`.
+         *
+         * @tparam Args Argument types of the topic.
+         * @param event_name The name of the event.
+         * @return A handle that can be used instead of the event name.
+         * @throws signature_mismatch If the topic is bound to different argument types.
+         */
+        template <typename... Args>
+        topic_handle<Args...> topic(const std::string& event_name) {
+            return topic_handle<Args...>(&bound_topic(event_name, detail::signature_of<Args...>()));
+        }
+
+        /**
+         * @brief Subscribes to an event with a given handler.
+         * @tparam Args Argument types for the handler.
+         * @param event_name The name of the event.
+         * @param handler The handler to be called when the event is triggered.
+         * @return A subscription ID.
+         * @throws signature_mismatch If the topic is bound to different argument types.
+         * @throws std::logic_error If the current last subscriber takes ownership of move-only arguments.
+         */
+        template <typename... Args>
+        int subscribe(const std::string& event_name, event_handler<Args...> handler) {
+            auto& slot = bound_topic(event_name, detail::signature_of<Args...>());
+            std::unique_lock lock(shard_of(slot));
+            return add_handler<std::decay_t<Args>...>(slot, std::move(handler));
+        }
+
+        /**
+         * @brief Subscribes to an interned topic with a given handler.
+         *
+         * The callable is stored by value in the topic's subscriber array; callables that fit
+         * `MICROBUS_HANDLER_INLINE_SIZE` are not heap allocated. The last subscriber receives the
+         * arguments as rvalues, so a handler taking a move-only argument by value must be subscribed last.
+         *
+         * @tparam Args Argument types of the topic.
+         * @tparam Fn Type of the callable, invocable with lvalues or rvalues of `Args...`.
+         * @param topic The topic handle.
+         * @param handler The handler to be called when the topic is triggered.
+         * @return A subscription ID.
+         * @throws std::logic_error If the current last subscriber takes ownership of move-only arguments.
+         */
+        template <typename... Args, typename Fn>
+        int subscribe(const topic_handle<Args...>& topic, Fn&& handler) {
+            static_assert(std::is_invocable_v<std::decay_t<Fn>&, Args&...> || std::is_invocable_v<std::decay_t<Fn>&, Args&&...>,
+                          "handler is not invocable with the topic argument types");
+            std::unique_lock lock(shard_of(*topic.slot_));
+            return add_handler<Args...>(*topic.slot_, std::forward<Fn>(handler));
+        }
+
+        /**
+         * @brief Subscribes to an interned topic with a handler that runs on an executor, such as an `event_loop`.
+         *
+         * `trigger` calls the inline subscribers directly and posts this handler through
+         * `executor.post(task)`, so it runs on the executor's threads without a hand-written
+         * second hop. All executor-bound subscribers of one event share a single copy of the
+         * arguments and receive it as const lvalues. Events already posted still run after
+         * `unsubscribe`, and the executor must outlive the subscription.
+         *
+         * @tparam Args Argument types of the topic, copyable.
+         * @tparam Fn Type of the callable, invocable with const lvalues of `Args...`.
+         * @tparam Executor Type of the executor, providing `post(task)`.
+         * @param topic The topic handle.
+         * @param handler The handler to be called on the executor when the topic is triggered.
+         * @param executor The executor, referenced until the subscription is removed.
+         * @return A subscription ID.
+         */
+        template <typename... Args, typename Fn, typename Executor>
+        int subscribe(const topic_handle<Args...>& topic, Fn&& handler, Executor& executor) {
+            static_assert(std::is_invocable_v<std::decay_t<Fn>&, const Args&...>,
+                          "handler is not invocable with the topic argument types");
+            static_assert(std::is_copy_constructible_v<std::tuple<Args...>>, "microbus: handlers on an executor need copyable arguments");
+            auto callable = std::make_shared<std::decay_t<Fn>>(std::forward<Fn>(handler));
+#if MICROBUS_ENABLE_METRICS
+            auto time = std::make_shared<detail::latency_histogram>();
+            auto run = [callable, time](const std::tuple<Args...>& payload) {
+                detail::scoped_timer timer(*time);
+                std::apply(*callable, payload);
+            };
+#else
+            auto run = [callable](const std::tuple<Args...>& payload) { std::apply(*callable, payload); };
+#endif
+            auto post = [run, &executor](const std::shared_ptr<const std::tuple<Args...>>& payload) {
+                executor.post([run, payload] { run(*payload); });
+            };
+
+            std::unique_lock lock(shard_of(*topic.slot_));
+            using list_type = detail::subscriber_list<Args...>;
+            auto* current = static_cast<const list_type*>(topic.slot_->handlers_.load(std::memory_order_relaxed));
+            auto next = current ? current->compacted(1) : std::make_unique<list_type>();
+            int id = next_id_.fetch_add(1, std::memory_order_relaxed);
+#if MICROBUS_ENABLE_METRICS
+            next->remote_.push_back({id, detail::inline_handler<std::shared_ptr<const std::tuple<Args...>>>(std::move(post)), std::move(time)});
+#else
+            next->remote_.push_back({id, detail::inline_handler<std::shared_ptr<const std::tuple<Args...>>>(std::move(post))});
+#endif
+            publish(*topic.slot_, next.release());
+            return id;
+        }
+
+        /**
+         * @brief Subscribes to every topic whose name matches a pattern.
+         *
+         * Names are split into segments at '.', in a pattern `*` matches exactly one segment and `#`
+         * any number of segments, including none, so `orders.*.filled` matches `orders.eu.filled`
+         * and `orders.#` every topic below `orders`. Matching topics bound to `Args...` receive the
+         * handler, both the existing ones and those interned later; topics bound to other argument
+         * types are skipped. The handler is added to the subscriber snapshot of each topic, so
+         * triggering costs the same as for an exact subscription. A single callable is shared by
+         * all matching topics and is always called with lvalues.
+         *
+         * @tparam Args Argument types of the matching topics.
+         * @tparam Fn Type of the callable, invocable with lvalues of `Args...`.
+         * @param pattern The subscription pattern.
+         * @param handler The handler to be called when a matching topic is triggered.
+         * @return A subscription ID, for `unsubscribe_pattern`.
+         * @throws std::invalid_argument If a wildcard does not span a whole segment.
+         */
+        template <typename... Args, typename Fn>
+        int subscribe_pattern(const std::string& pattern, Fn&& handler) {
+            static_assert(std::is_invocable_v<std::decay_t<Fn>&, std::decay_t<Args>&...>,
+                          "handler is not invocable with the topic argument types");
+            detail::check_pattern(pattern);
+            auto callable = std::make_shared<std::decay_t<Fn>>(std::forward<Fn>(handler));
+            detail::inline_handler<std::decay_t<Args>...> shared([callable](std::decay_t<Args>&... args) { (*callable)(args...); });
+
+            std::unique_lock lock(mutex_);
+            int id = next_id_.fetch_add(1, std::memory_order_relaxed);
+            auto subscription = std::make_unique<detail::pattern_subscription<std::decay_t<Args>...>>(id, pattern, std::move(shared));
+            for (auto& slot : slots_) {
+                if (slot.signature_.load(std::memory_order_relaxed) == subscription->signature_ && detail::topic_matches(pattern, slot.name_)) {
+                    attach_pattern(slot, *subscription);
+                }
+            }
+            pattern_index_.insert(subscription.get());
+            patterns_.emplace(id, std::move(subscription));
+            has_patterns_.store(true, std::memory_order_relaxed);
+            return id;
+        }
+
+        /**
+         * @brief Unsubscribes a pattern subscription from every topic it was added to.
+         * @param pattern The subscription pattern.
+         * @param id The subscription ID.
+         */
+        void unsubscribe_pattern(const std::string& pattern, int id) {
+            std::unique_lock lock(mutex_);
+            auto it = patterns_.find(id);
+            if (it == patterns_.end() || it->second->pattern_ != pattern) {
+                return;
+            }
+            for (auto* slot : it->second->topics_) {
+                std::unique_lock shard(shard_of(*slot));
+                remove_handler(*slot, id);
+            }
+            pattern_index_.erase(it->second.get());
+            patterns_.erase(it);
+            has_patterns_.store(!patterns_.empty(), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Unsubscribes from an event.
+         * @param event_name The name of the event.
+         * @param id The subscription ID.
+         */
+        void unsubscribe(const std::string& event_name, int id) {
+            detail::topic_slot* slot;
+            {
+                detail::epoch_guard guard;
+                slot = find_topic(event_name);
+            }
+            if (slot) {
+                std::unique_lock lock(shard_of(*slot));
+                remove_handler(*slot, id);
+            }
+        }
+
+        /**
+         * @brief Unsubscribes from an interned topic.
+         * @tparam Args Argument types of the topic.
+         * @param topic The topic handle.
+         * @param id The subscription ID.
+         */
+        template <typename... Args>
+        void unsubscribe(const topic_handle<Args...>& topic, int id) {
+            std::unique_lock lock(shard_of(*topic.slot_));
+            remove_handler(*topic.slot_, id);
+        }
+
+        /**
+         * @brief Triggers an event and calls all subscribed handlers.
+         *
+         * The decayed argument types are checked against the topic signature at run time.
+         *
+         * @tparam Args Argument types for the event.
+         * @param event_name The name of the event.
+         * @param params The arguments to pass to the handlers.
+         * @throws signature_mismatch If the argument types do not match the topic signature.
+         */
+        template <typename... Args>
+        void trigger(const std::string& event_name, Args&&... params) {
+            detail::epoch_guard guard;
+            auto* slot = find_topic(event_name);
+            if (!slot && !(slot = intern_matching(event_name, detail::signature_of<Args...>()))) {
+                return;
+            }
+            if (!slot->handlers_.load() && !detail::waiting_coroutines::pending(*slot)) {
+                count_publish(*slot, nullptr);
+                return;
+            }
+            check_signature(*slot, detail::signature_of<Args...>());
+            std::tuple<std::decay_t<Args>...> tuple_args(std::forward<Args>(params)...);
+            std::apply([this, slot](auto&... unpacked) { deliver(*slot, unpacked...); }, tuple_args);
+        }
+
+        /**
+         * @brief Triggers an interned topic and calls all subscribed handlers.
+         *
+         * The signature was checked when the handle was created, so dispatch calls the
+         * stored callables directly.
+         *
+         * @tparam Args Argument types of the topic.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param topic The topic handle.
+         * @param params The arguments to pass to the handlers.
+         */
+        template <typename... Args, typename... Params>
+        void trigger(const topic_handle<Args...>& topic, Params&&... params) {
+            auto* slot = topic.slot_;
+            if (!slot->handlers_.load(std::memory_order_relaxed) && !detail::waiting_coroutines::pending(*slot)) {
+                count_publish(*slot, nullptr);
+                return;
+            }
+            std::tuple<Args...> tuple_args(std::forward<Params>(params)...);
+            std::apply([this, slot](Args&... unpacked) { deliver(*slot, unpacked...); }, tuple_args);
+        }
+
+        /**
+         * @brief Triggers a request topic and returns a future for the first reply.
+         *
+         * The subscribers receive a `reply<R>` token before the arguments and answer through
+         * `reply<R>::send`, right away or later from any thread. The request is correlated through a
+         * lock-free slot table instead of a reply topic, so it neither subscribes nor takes a lock.
+         *
+         * @tparam R Type of the reply.
+         * @tparam Args Argument types of the topic after the token.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param topic The topic handle.
+         * @param params The arguments to pass to the handlers.
+         * @return The future of the first reply, broken if every token is dropped without a reply.
+         * @throws std::length_error If too many requests are pending.
+         */
+        template <typename R, typename... Args, typename... Params>
+        std::future<R> request(const topic_handle<reply<R>, Args...>& topic, Params&&... params) {
+            auto* sink = make_sink<detail::single_reply<R>>(memory_);
+            auto future = sink->future();
+            trigger(topic, open_reply<R>(sink), std::forward<Params>(params)...);
+            return future;
+        }
+
+        /**
+         * @brief Triggers a request topic and collects the replies of its subscribers.
+         *
+         * Works like `request`, but completes once `options.count` replies have arrived, once every
+         * token is dropped, or once the timeout elapses, with the replies received by then. The timeout
+         * needs `options.timer` and a bus owned by a `shared_ptr`.
+         *
+         * @tparam R Type of a reply.
+         * @tparam Args Argument types of the topic after the token.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param topic The topic handle.
+         * @param options The number of replies and the timeout.
+         * @param params The arguments to pass to the handlers.
+         * @return The future of the replies, in arrival order.
+         * @throws std::length_error If too many requests are pending.
+         * @throws std::logic_error If a timeout is set without a timer loop, or the bus is not owned by a `shared_ptr`.
+         */
+        template <typename R, typename... Args, typename... Params>
+        std::future<std::vector<R>> gather(const topic_handle<reply<R>, Args...>& topic, const gather_options& options, Params&&... params) {
+            std::shared_ptr<event_bus> self;
+            if (options.timeout > std::chrono::nanoseconds::zero()) {
+                self = weak_from_this().lock();
+                if (!options.timer || !self) {
+                    throw std::logic_error("microbus: a gather timeout needs a timer loop and a bus owned by a shared_ptr");
+                }
+            }
+            auto* sink = make_sink<detail::gathered_replies<R>>(memory_, options.count);
+            auto future = sink->future();
+            auto token = open_reply<R>(sink);
+            if (self) {
+                detail::post_after(*options.timer, options.timeout, [bus = std::weak_ptr<event_bus>(self), id = token.correlation_id()] {
+                    if (auto owner = bus.lock(); owner && owner->replies_.acquire(id)) {
+                        owner->replies_.sink(id)->expire();
+                        owner->replies_.release(id);
+                    }
+                });
+            }
+            trigger(topic, std::move(token), std::forward<Params>(params)...);
+            return future;
+        }
+
+#if MICROBUS_HAS_COROUTINES
+        /**
+         * @brief Gets an awaitable for the next event of an interned topic, resumed on the triggering thread.
+         * @tparam Args Argument types of the topic.
+         * @param topic The topic handle.
+         * @return The awaitable.
+         */
+        template <typename... Args>
+        [[nodiscard]] next_event<Args...> next(const topic_handle<Args...>& topic) const {
+            static_assert(std::is_copy_constructible_v<std::tuple<Args...>>, "microbus: awaited topics need copyable arguments");
+            return next_event<Args...>(*topic.slot_);
+        }
+
+        /**
+         * @brief Gets an awaitable for the next event of a named topic, resumed on the triggering thread.
+         * @tparam Args Argument types for the event.
+         * @param event_name The name of the event.
+         * @return The awaitable.
+         * @throws signature_mismatch If the topic is bound to different argument types.
+         */
+        template <typename... Args>
+        [[nodiscard]] next_event<std::decay_t<Args>...> next(const std::string& event_name) {
+            return next(topic<std::decay_t<Args>...>(event_name));
+        }
+#endif
+
+        /**
+         * @brief Clears all subscriptions, including pattern subscriptions.
+         *
+         * Interned topics and their signatures are kept, so existing topic handles remain valid.
+         * Each shard is emptied in one step: its snapshots are swapped out under the shard lock
+         * and retired together once the lock is released.
+         */
+        void clear() {
+            std::unique_lock lock(mutex_);
+            std::vector<const detail::subscriber_list_base*> retired;
+            for (std::size_t shard = 0; shard < shard_count_; ++shard) {
+                {
+                    std::unique_lock shard_lock(shards_[shard].mutex_);
+                    for (auto id = shard; id < slots_.size(); id += shard_count_) {
+                        retired.push_back(slots_[id].handlers_.exchange(nullptr));
+                    }
+                }
+                detail::epoch_domain::instance().retire(retired);
+                retired.clear();
+            }
+            pattern_index_.clear();
+            patterns_.clear();
+            has_patterns_.store(false, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Takes a snapshot of the per-topic statistics.
+         *
+         * Reading the counters does not block triggers. Without `MICROBUS_ENABLE_METRICS`
+         * the snapshot is empty.
+         *
+         * @return Statistics of every interned topic, ordered by topic ID.
+         */
+        [[nodiscard]] std::vector<topic_metrics> metrics() const {
+            std::vector<topic_metrics> out;
+#if MICROBUS_ENABLE_METRICS
+            detail::epoch_guard guard;
+            auto* directory = directory_.load();
+            if (!directory) {
+                return out;
+            }
+            out.reserve(directory->by_id_.size());
+            for (const auto* slot : directory->by_id_) {
+                auto& topic = out.emplace_back();
+                topic.name = slot->name_;
+                topic.published = slot->counters_.load(0);
+                topic.delivered = slot->counters_.load(1);
+                if (auto* handlers = slot->handlers_.load()) {
+                    handlers->collect(topic.subscribers);
+                }
+            }
+#endif
+            return out;
+        }
+
+    private:
+        detail::reply_table replies_; ///< Correlation slots of the pending requests, destroyed after the handlers that may hold tokens.
+        std::deque<detail::topic_slot> slots_; ///< Storage of the interned topics, elements never move.
+        std::atomic<const detail::topic_directory*> directory_{nullptr}; ///< Current snapshot of the interned topics.
+        std::mutex mutex_; ///< Serializes interning topics and pattern subscriptions, taken before a shard lock.
+        std::unique_ptr<detail::bus_shard[]> shards_; ///< Subscription locks, topic IDs are spread round-robin.
+        std::size_t shard_count_; ///< Number of shards.
+        std::pmr::memory_resource* memory_; ///< Allocates the arguments shared by executor-bound subscribers.
+        std::unordered_map<int, std::unique_ptr<detail::pattern_subscription_base>> patterns_; ///< Pattern subscriptions by ID.
+        detail::pattern_trie pattern_index_; ///< Pattern subscriptions by pattern segment.
+        std::atomic<bool> has_patterns_{false}; ///< Whether unknown topics may match a pattern subscription.
+        error_options errors_{}; ///< What to do when a handler throws, set before the bus is shared.
+
+        friend class event_loop;
+
+        /**
+         * @brief Finds an interned topic, the caller must be pinned or hold the mutex.
+         * @param event_name The name of the event.
+         * @return The topic slot, or nullptr if the topic was never interned.
+         */
+        detail::topic_slot* find_topic(const std::string& event_name) const {
+            auto* directory = directory_.load();
+            if (!directory) {
+                return nullptr;
+            }
+            auto it = directory->by_name_.find(event_name);
+            return it != directory->by_name_.end() ? it->second : nullptr;
+        }
+
+        /**
+         * @brief Gets the lock of the shard a topic belongs to.
+         * @param slot The topic slot.
+         * @return The shard mutex.
+         */
+        std::mutex& shard_of(const detail::topic_slot& slot) const {
+            return shards_[slot.id_ % shard_count_].mutex_;
+        }
+
+        /**
+         * @brief Finds a topic bound to a signature, interning and binding it under the mutex on first use.
+         * @param event_name The name of the event.
+         * @param signature The signature identity.
+         * @return The topic slot.
+         * @throws signature_mismatch If the topic is bound to a different signature.
+         */
+        detail::topic_slot& bound_topic(const std::string& event_name, const void* signature) {
+            {
+                detail::epoch_guard guard;
+                auto* slot = find_topic(event_name);
+                if (slot && slot->signature_.load(std::memory_order_acquire)) {
+                    check_signature(*slot, signature);
+                    return *slot;
+                }
+            }
+            std::unique_lock lock(mutex_);
+            auto& slot = intern(event_name);
+            bind_signature(slot, signature);
+            return slot;
+        }
+
+        /**
+         * @brief Finds or creates an interned topic, the caller must hold the mutex.
+         * @param event_name The name of the event.
+         * @return The topic slot.
+         */
+        detail::topic_slot& intern(const std::string& event_name) {
+            if (auto* slot = find_topic(event_name)) {
+                return *slot;
+            }
+            auto& slot = slots_.emplace_back(event_name, slots_.size());
+
+            auto* current = directory_.load(std::memory_order_relaxed);
+            auto* next = current ? new detail::topic_directory(*current) : new detail::topic_directory();
+            next->by_name_.emplace(event_name, &slot);
+            next->by_id_.push_back(&slot);
+            directory_.store(next);
+            detail::epoch_domain::instance().retire(current);
+            return slot;
+        }
+
+        /**
+         * @brief Binds a topic to a signature on first use and adds the matching pattern subscriptions, the caller must hold the mutex.
+         * @param slot The topic slot.
+         * @param signature The signature identity.
+         * @throws signature_mismatch If the topic is bound to a different signature.
+         */
+        void bind_signature(detail::topic_slot& slot, const void* signature) {
+            auto* bound = slot.signature_.load(std::memory_order_relaxed);
+            if (!bound) {
+                slot.signature_.store(signature, std::memory_order_release);
+                for (auto* subscription : pattern_index_.match(slot.name_)) {
+                    if (subscription->signature_ == signature) {
+                        attach_pattern(slot, *subscription);
+                    }
+                }
+            } else if (bound != signature) {
+                throw signature_mismatch(slot.name_);
+            }
+        }
+
+        /**
+         * @brief Interns a topic that is triggered by name before it was interned, if a pattern subscription matches it.
+         * @param event_name The name of the event.
+         * @param signature The signature identity of the event arguments.
+         * @return The topic slot, or nullptr if no pattern subscription for the signature matches.
+         */
+        detail::topic_slot* intern_matching(const std::string& event_name, const void* signature) {
+            if (!has_patterns_.load(std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            std::unique_lock lock(mutex_);
+            if (auto* slot = find_topic(event_name)) {
+                return slot;
+            }
+            auto matches = pattern_index_.match(event_name);
+            if (std::none_of(matches.begin(), matches.end(), [signature](auto* m) { return m->signature_ == signature; })) {
+                return nullptr;
+            }
+            auto& slot = intern(event_name);
+            bind_signature(slot, signature);
+            return &slot;
+        }
+
+        /**
+         * @brief Adds a pattern subscription to a matching topic under its shard lock, the caller must hold the mutex.
+         * @param slot The topic slot, bound to the signature of the subscription.
+         * @param subscription The pattern subscription.
+         */
+        void attach_pattern(detail::topic_slot& slot, detail::pattern_subscription_base& subscription) {
+            std::unique_lock lock(shard_of(slot));
+            auto* current = slot.handlers_.load(std::memory_order_relaxed);
+            if (auto* next = subscription.attach(current); next != current) {
+                publish(slot, next);
+            }
+            subscription.topics_.push_back(&slot);
+        }
+
+        /**
+         * @brief Checks a signature against the one a topic is bound to.
+         * @param slot The topic slot.
+         * @param signature The signature identity.
+         * @throws signature_mismatch If the topic is bound to a different signature.
+         */
+        static void check_signature(const detail::topic_slot& slot, const void* signature) {
+            if (slot.signature_.load(std::memory_order_acquire) != signature) {
+                throw signature_mismatch(slot.name_);
+            }
+        }
+
+        /**
+         * @brief Swaps in a new subscriber snapshot, the caller must hold the shard lock of the topic.
+         * @param slot The topic slot.
+         * @param handlers The new snapshot, or nullptr if the topic has no subscribers.
+         */
+        static void publish(detail::topic_slot& slot, const detail::subscriber_list_base* handlers) {
+            auto* previous = slot.handlers_.exchange(handlers);
+            detail::epoch_domain::instance().retire(previous);
+        }
+
+        /**
+         * @brief Adds a handler to a topic, the caller must hold its shard lock and have bound the signature.
+         * @tparam Ts Decayed argument types of the topic.
+         * @tparam Fn Type of the callable.
+         * @param slot The topic slot.
+         * @param handler The handler to add.
+         * @return A subscription ID.
+         * @throws std::logic_error If the current last subscriber takes ownership of move-only arguments.
+         */
+        template <typename... Ts, typename Fn>
+        int add_handler(detail::topic_slot& slot, Fn&& handler) {
+            using list_type = detail::subscriber_list<Ts...>;
+            // Only the shard's writer mutates a published snapshot, and only past the prefix readers see.
+            auto* current = const_cast<list_type*>(static_cast<const list_type*>(slot.handlers_.load(std::memory_order_relaxed)));
+            if (const auto* last = current ? current->last_live() : nullptr; last && !last->handler_.shareable()) {
+                throw std::logic_error("microbus: a handler owning the arguments must be the last subscriber of topic '" + slot.name_ + "'");
+            }
+            int id = next_id_.fetch_add(1, std::memory_order_relaxed);
+
+#if MICROBUS_ENABLE_METRICS
+            typename list_type::entry subscriber{id, detail::inline_handler<Ts...>(std::forward<Fn>(handler)), std::make_shared<detail::latency_histogram>()};
+#else
+            typename list_type::entry subscriber{id, detail::inline_handler<Ts...>(std::forward<Fn>(handler))};
+#endif
+            if (current && !current->full()) {
+                current->append(std::move(subscriber));
+                return id;
+            }
+            auto next = current ? current->compacted(1) : std::make_unique<list_type>();
+            next->append(std::move(subscriber));
+            publish(slot, next.release());
+            return id;
+        }
+
+        /**
+         * @brief Removes a handler from a topic, the caller must hold its shard lock.
+         * @param slot The topic slot.
+         * @param id The subscription ID.
+         */
+        static void remove_handler(detail::topic_slot& slot, int id) {
+            auto* current = slot.handlers_.load(std::memory_order_relaxed);
+            if (!current) {
+                return;
+            }
+            // Only the shard's writer mutates a published snapshot, tombstones are atomic flags readers skip.
+            if (auto* next = const_cast<detail::subscriber_list_base*>(current)->remove(id); next != current) {
+                publish(slot, next);
+            }
+        }
+
+        /**
+         * @brief Checks the signature of a queued event before it is packed.
+         * @param event_name The name of the event.
+         * @param signature The signature identity of the event arguments.
+         * @throws signature_mismatch If the topic exists and is bound to a different signature.
+         */
+        void check_enqueue(const std::string& event_name, const void* signature) const {
+            detail::epoch_guard guard;
+            auto* slot = find_topic(event_name);
+            auto* bound = slot ? slot->signature_.load(std::memory_order_acquire) : nullptr;
+            if (bound && bound != signature) {
+                throw signature_mismatch(event_name);
+            }
+        }
+
+        /**
+         * @brief Internal method to trigger an event packed by the event loop.
+         *
+         * Events whose signature does not match the topic are not delivered.
+         *
+         * @tparam Ts Decayed argument types of the event.
+         * @param event_name The name of the event.
+         * @param args The packed arguments, moved into the last subscriber.
+         */
+        template <typename... Ts>
+        void trigger_impl(const std::string& event_name, std::tuple<Ts...>& args) {
+            detail::epoch_guard guard;
+            auto* slot = find_topic(event_name);
+            if (!slot) {
+                slot = intern_matching(event_name, detail::signature_of<Ts...>());
+            }
+            if (slot && slot->signature_.load(std::memory_order_acquire) == detail::signature_of<Ts...>()) {
+                std::apply([this, slot](Ts&... unpacked) { deliver(*slot, unpacked...); }, args);
+            }
+        }
+
+        /**
+         * @brief Internal method to call the subscribers of an interned topic with unpacked arguments.
+         * @tparam Ts Decayed argument types of the topic.
+         * @param slot The topic slot, bound to `Ts...`.
+         * @param args The arguments, moved into the last subscriber.
+         */
+        template <typename... Ts>
+        void deliver(const detail::topic_slot& slot, Ts&... args) {
+            detail::epoch_guard guard;
+            auto* handlers = slot.handlers_.load();
+            count_publish(slot, handlers);
+            detail::waiting_coroutines waiting(slot, args...);
+            if (!handlers) {
+                return;
+            }
+            auto* list = static_cast<const detail::subscriber_list<Ts...>*>(handlers);
+            if (errors_.policy == error_policy::propagate) {
+                list->invoke(memory_, args...);
+            } else {
+                list->invoke_guarded(memory_, [&](int id) { handle_error(slot, id, 1, args...); }, args...);
+            }
+        }
+
+        /**
+         * @brief Applies the error policy to a handler that threw, called inside the handler of the exception.
+         * @tparam Ts Decayed argument types of the topic.
+         * @param slot The topic slot.
+         * @param id The subscription ID.
+         * @param attempts Number of times the handler was called with the event.
+         * @param args The arguments of the event.
+         */
+        template <typename... Ts>
+        void handle_error(const detail::topic_slot& slot, int id, unsigned attempts, [[maybe_unused]] Ts&... args) {
+            handler_error error{slot.name_, id, std::current_exception(), attempts};
+            if (slot.name_ == dead_letter_topic || errors_.policy == error_policy::log) {
+                report(error);
+                return;
+            }
+            if constexpr ((std::is_copy_constructible_v<Ts> && ...)) {
+                if (errors_.policy == error_policy::retry && attempts <= errors_.max_retries && errors_.retry_loop) {
+                    if (auto self = weak_from_this().lock()) {
+                        auto delay = errors_.backoff * (std::uint64_t{1} << std::min(attempts - 1, 62u));
+                        auto retry = [bus = std::weak_ptr<event_bus>(self), &slot, id, attempts, args = std::make_tuple(args...)]() mutable {
+                            if (auto owner = bus.lock()) {
+                                owner->redeliver(slot, id, attempts + 1, args);
+                            }
+                        };
+                        if (detail::post_after(*errors_.retry_loop, delay, std::move(retry))) {
+                            return;
+                        }
+                    }
+                }
+            }
+            auto* dead = find_topic(dead_letter_topic);
+            if (!dead || !dead->handlers_.load() || dead->signature_.load(std::memory_order_acquire) != detail::signature_of<handler_error>()) {
+                report(error);
+                return;
+            }
+            deliver(*dead, error);
+        }
+
+        /**
+         * @brief Calls a subscriber again with an event its handler threw on.
+         * @tparam Ts Decayed argument types of the topic.
+         * @param slot The topic slot.
+         * @param id The subscription ID, nothing happens if it was unsubscribed.
+         * @param attempts Number of times the handler will have been called with the event.
+         * @param args The arguments of the event.
+         */
+        template <typename... Ts>
+        void redeliver(const detail::topic_slot& slot, int id, unsigned attempts, std::tuple<Ts...>& args) {
+            detail::epoch_guard guard;
+            if (auto* handlers = slot.handlers_.load()) {
+                std::apply([&](Ts&... unpacked) {
+                    static_cast<const detail::subscriber_list<Ts...>*>(handlers)->invoke_one(id, 0, [&](int) { handle_error(slot, id, attempts, unpacked...); }, unpacked...);
+                }, args);
+            }
+        }
+
+        /**
+         * @brief Calls the subscribers of a fan-out that are still unclaimed, one at a time.
+         * @tparam Ts Decayed argument types of the topic.
+         * @param state The fan-out.
+         */
+        template <typename... Ts>
+        void run_fan_out(detail::fan_out<Ts...>& state) {
+            detail::epoch_guard guard;
+            auto* handlers = static_cast<const detail::subscriber_list<Ts...>*>(state.slot_->handlers_.load());
+            if (!handlers) {
+                return;
+            }
+            std::apply([&](Ts&... args) {
+                for (auto i = state.next_.fetch_add(1, std::memory_order_relaxed); i < state.targets_.size(); i = state.next_.fetch_add(1, std::memory_order_relaxed)) {
+                    auto [position, id] = state.targets_[i];
+                    handlers->invoke_one(id, position, [&](int) {
+                        if (errors_.policy == error_policy::propagate) {
+                            state.fail(std::current_exception());
+                        } else {
+                            handle_error(*state.slot_, id, 1, args...);
+                        }
+                    }, args...);
+                    state.called();
+                }
+            }, state.args_);
+        }
+
+        /**
+         * @brief Constructs the receiver of a request with the memory resource of the bus.
+         * @tparam Sink Type of the receiver.
+         * @tparam Params Types of the constructor arguments after the memory resource.
+         * @param memory Allocates the receiver.
+         * @param params The constructor arguments after the memory resource.
+         * @return The receiver, destroyed by the correlation table.
+         */
+        template <typename Sink, typename... Params>
+        static Sink* make_sink(std::pmr::memory_resource* memory, Params&&... params) {
+            auto* storage = memory->allocate(sizeof(Sink), alignof(Sink));
+            try {
+                return ::new (storage) Sink(memory, std::forward<Params>(params)...);
+            } catch (...) {
+                memory->deallocate(storage, sizeof(Sink), alignof(Sink));
+                throw;
+            }
+        }
+
+        /**
+         * @brief Registers a request in the correlation table.
+         * @tparam R Type of a reply.
+         * @param sink The receiver of the replies, destroyed if no slot is free.
+         * @return The token of the request.
+         */
+        template <typename R>
+        reply<R> open_reply(detail::reply_sink<R>* sink) {
+            try {
+                return reply<R>(&replies_, replies_.open(sink));
+            } catch (...) {
+                sink->destroy();
+                throw;
+            }
+        }
+
+        /**
+         * @brief Logs an error to the error callback, or to standard error without one.
+         * @param error The error.
+         */
+        void report(const handler_error& error) const {
+            if (errors_.on_error) {
+                errors_.on_error(error);
+                return;
+            }
+            try {
+                std::rethrow_exception(error.error);
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "microbus: handler %d of topic '%s' threw: %s\n", error.subscription, error.topic.c_str(), e.what());
+            } catch (...) {
+                std::fprintf(stderr, "microbus: handler %d of topic '%s' threw\n", error.subscription, error.topic.c_str());
+            }
+        }
+
+        /**
+         * @brief Counts an event of a topic and the handler calls it makes, a no-op without metrics.
+         * @param slot The topic slot.
+         * @param handlers The subscriber snapshot the event is delivered to, may be nullptr.
+         */
+        static void count_publish([[maybe_unused]] const detail::topic_slot& slot,
+                                  [[maybe_unused]] const detail::subscriber_list_base* handlers) {
+#if MICROBUS_ENABLE_METRICS
+            slot.counters_.add(0, 1);
+            slot.counters_.add(1, handlers ? handlers->size() : 0);
+#endif
+        }
+
+        std::atomic<int> next_id_{0}; ///< The next subscription ID.
+    };
+
+    /**
+     * @brief What `event_loop::enqueue_event` does when the queue is full.
+     */
+    enum class overflow_policy {
+        block, ///< Wait until the loop frees a slot.
+        drop_oldest, ///< Discard the oldest queued event of the full queue to make room for the new one; workers then take events one at a time and free their slots before running them.
+        drop_newest, ///< Discard the new event and report `enqueue_result::dropped`.
+        fail, ///< Leave the event to the caller and report `enqueue_result::rejected`.
+    };
+
+    /**
+     * @brief Outcome of enqueueing an event.
+     */
+    enum class enqueue_result {
+        queued, ///< The event was placed in the queue.
+        dropped, ///< The queue was full and the event was discarded.
+        rejected, ///< The event was not accepted, the queue was full, the event exceeds `byte_capacity` or the loop is stopping.
+        conflated, ///< The event replaced a pending event of the same topic and key, see `event_loop::enqueue_latest`.
+    };
+
+    /**
+     * @brief Priority lane of a queued event, workers drain higher lanes first.
+     */
+    enum class priority {
+        high, ///< Control-plane events, run before everything else.
+        normal, ///< The default lane, also used by ordered events.
+        low, ///< Bulk events, run when the other lanes are idle.
+    };
+
+    /**
+     * @brief Number of priority lanes.
+     */
+    inline constexpr std::size_t priority_count = 3;
+
+    /**
+     * @brief What a worker does with an event whose deadline passed before it started running.
+     */
+    enum class expiry_policy {
+        drop, ///< Discard the event without calling its handlers.
+        run, ///< Deliver the event late.
+    };
+
+    /**
+     * @brief Per-event options of `event_loop::enqueue_event`.
+     */
+    struct enqueue_options {
+        priority lane = priority::normal; ///< Lane the event is queued in.
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(); ///< Latest time the event may start running.
+    };
+
+    /**
+     * @brief How an idle worker waits for events before it parks.
+     *
+     * A worker that finds its queues empty polls them `spin` times with a pause instruction in
+     * between, then `yield` times yielding the processor, and only then parks. Producers skip the
+     * wakeup of a worker that has not parked, so a spinning worker picks up an event without a
+     * system call on either side, at the cost of a busy core while idle.
+     */
+    struct idle_strategy {
+        std::size_t spin = 0; ///< Polls with a pause instruction before yielding.
+        std::size_t yield = 0; ///< Polls that yield the processor before parking.
+
+        /**
+         * @brief Gets a strategy for latency-sensitive loops that keeps polling for roughly 100 microseconds before parking.
+         * @return The strategy.
+         */
+        static constexpr idle_strategy latency() { return {1 << 12, 1 << 8}; }
+
+        /**
+         * @brief Gets a strategy that parks as soon as the queues are empty.
+         * @return The strategy.
+         */
+        static constexpr idle_strategy power_saving() { return {0, 0}; }
+    };
+
+    /**
+     * @brief Construction options of an event loop.
+     */
+    struct event_loop_options {
+        std::size_t capacity = 1024; ///< Number of event slots per worker queue, rounded up to a power of two.
+        overflow_policy on_overflow = overflow_policy::block; ///< Behavior when all slots are taken.
+        std::size_t worker_count = 1; ///< Number of worker threads, idle workers steal from busy ones; zero for a threadless loop run by `poll` and `run_for`.
+        bool ordered_topics = false; ///< Deliver events of the same topic in order when running several workers.
+        std::size_t batch_size = 64; ///< Maximum number of events a worker claims and runs before signalling waiters.
+        std::size_t starvation_limit = 8; ///< Consecutive batches a worker runs from higher lanes while a lower lane waits, before serving it.
+        expiry_policy on_expired = expiry_policy::drop; ///< Behavior for events whose deadline has passed.
+        std::chrono::nanoseconds timer_resolution = std::chrono::milliseconds(1); ///< Tick length of the timer wheel.
+        std::size_t byte_capacity = 0; ///< Maximum size of all queued tasks and their packed arguments in bytes, zero for no limit; a single larger event is rejected.
+        std::pmr::memory_resource* memory = nullptr; ///< Allocates events larger than `MICROBUS_EVENT_INLINE_SIZE` and tracked event states, nullptr for the built-in per-thread slab pool.
+        idle_strategy idle = idle_strategy::power_saving(); ///< How idle workers wait before parking.
+        std::vector<int> cpus{}; ///< CPUs the workers run on, empty to leave placement to the scheduler (Linux only).
+        bool pin_workers = false; ///< Pin worker `i` to `cpus[i % cpus.size()]` alone instead of letting every worker use all of `cpus`.
+        int numa_node = -1; ///< NUMA node the worker queues are placed on, and the workers run on when `cpus` is empty, -1 for none (Linux only).
+        int sched_policy = -1; ///< Scheduling policy of the workers such as `SCHED_FIFO`, -1 to inherit it (Linux only).
+        int sched_priority = 0; ///< Priority of the workers under `sched_policy`.
+        std::string thread_name{}; ///< Name of the worker threads, suffixed with the worker index when there are several, at most 15 characters are kept (Linux only).
+        std::function<void(std::exception_ptr)> on_error{}; ///< Receives exceptions that escape an event or posted task, which then keeps the worker running; empty to let them terminate the process.
+    };
+
+    /**
+     * @brief A handle to a pending delayed or periodic event, used to cancel it.
+     */
+    class timer_handle {
+    public:
+        timer_handle() = default;
+
+        /**
+         * @brief Checks whether the handle refers to a timer.
+         * @return True if it was returned by a loop; the timer may have fired or been cancelled since.
+         */
+        [[nodiscard]] bool valid() const { return generation_ != 0; }
+
+    private:
+        friend class event_loop;
+
+        timer_handle(std::uint32_t index, std::uint32_t generation) : index_(index), generation_(generation) {}
+
+        std::uint32_t index_ = 0; ///< Node of the timer in the wheel.
+        std::uint32_t generation_ = 0; ///< Generation of the node when the timer was armed, zero for no timer.
+    };
+
+    namespace detail {
+#if defined(__linux__)
+        /**
+         * @brief Gets the CPUs of a NUMA node.
+         * @param node The node.
+         * @return The CPU numbers.
+         * @throws std::invalid_argument If the node does not exist.
+         */
+        inline std::vector<int> numa_node_cpus(int node) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+            if (!(in >> list)) {
+                throw std::invalid_argument("microbus: unknown NUMA node " + std::to_string(node));
+            }
+            // The list is a comma-separated sequence of CPUs and inclusive ranges, for example "0-3,8".
+            std::vector<int> cpus;
+            for (std::size_t pos = 0; pos < list.size();) {
+                auto comma = std::min(list.find(',', pos), list.size());
+                auto range = list.substr(pos, comma - pos);
+                auto dash = range.find('-');
+                int first = std::stoi(range.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+                pos = comma + 1;
+            }
+            return cpus;
+        }
+
+        /**
+         * @brief Places the whole pages of a memory range on a NUMA node, moving those already touched.
+         * @param data Start of the range.
+         * @param bytes Size of the range.
+         * @param node The node.
+         * @throws std::system_error If the kernel rejects the placement.
+         */
+        inline void prefer_numa_node(void* data, std::size_t bytes, int node) {
+            constexpr int mpol_preferred = 1;
+            constexpr unsigned mpol_mf_move = 1u << 1;
+            constexpr std::size_t max_nodes = 1024;
+            constexpr std::size_t word_bits = 8 * sizeof(unsigned long);
+            if (node < 0 || static_cast<std::size_t>(node) >= max_nodes) {
+                throw std::invalid_argument("microbus: unknown NUMA node " + std::to_string(node));
+            }
+            auto page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+            auto begin = (reinterpret_cast<std::uintptr_t>(data) + page - 1) / page * page;
+            auto end = (reinterpret_cast<std::uintptr_t>(data) + bytes) / page * page;
+            if (end <= begin) {
+                return;
+            }
+            unsigned long mask[max_nodes / word_bits] = {};
+            mask[static_cast<std::size_t>(node) / word_bits] |= 1ul << (static_cast<std::size_t>(node) % word_bits);
+            if (::syscall(SYS_mbind, begin, end - begin, mpol_preferred, mask, max_nodes, mpol_mf_move) != 0) {
+                throw std::system_error(errno, std::generic_category(), "microbus: mbind");
+            }
+        }
+
+        /**
+         * @brief Sets the placement, scheduling and name of a running thread.
+         * @param thread The thread.
+         * @param cpus CPUs the thread may run on, empty to leave it unchanged.
+         * @param policy Scheduling policy, -1 to leave it unchanged.
+         * @param priority Priority under the policy.
+         * @param name Thread name, empty to leave it unchanged.
+         * @throws std::invalid_argument If a CPU number is out of range.
+         * @throws std::system_error If the affinity or the scheduling parameters are rejected.
+         */
+        inline void configure_thread(std::thread& thread, const std::vector<int>& cpus, int policy, int priority, const std::string& name) {
+            auto handle = thread.native_handle();
+            if (!cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : cpus) {
+                    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                        throw std::invalid_argument("microbus: invalid CPU " + std::to_string(cpu));
+                    }
+                    CPU_SET(cpu, &set);
+                }
+                if (auto error = ::pthread_setaffinity_np(handle, sizeof(set), &set)) {
+                    throw std::system_error(error, std::generic_category(), "microbus: pthread_setaffinity_np");
+                }
+            }
+            if (policy >= 0) {
+                sched_param param{};
+                param.sched_priority = priority;
+                if (auto error = ::pthread_setschedparam(handle, policy, &param)) {
+                    throw std::system_error(error, std::generic_category(), "microbus: pthread_setschedparam");
+                }
+            }
+            if (!name.empty()) {
+                // Names are only diagnostics, a rejected one leaves the inherited name.
+                ::pthread_setname_np(handle, name.substr(0, 15).c_str());
+            }
+        }
+#endif
+
+        /**
+         * @brief Hints the processor that the caller is spinning.
+         */
+        inline void spin_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+
+        /**
+         * @brief A queued event stored inline in a preallocated queue slot.
+         *
+         * Tasks up to `MICROBUS_EVENT_INLINE_SIZE` bytes live inside the record, larger ones
+         * are allocated from the memory resource of the ring and returned to it after running.
+         */
+        class event_record {
+        public:
+            event_record() = default;
+            event_record(const event_record&) = delete;
+            event_record& operator=(const event_record&) = delete;
+
+            /**
+             * @brief Constructs a task in the record, the record must be empty.
+             * @tparam Fn Type of the task.
+             * @param fn The task, invoked without arguments.
+             */
+            template <typename Fn>
+            void emplace(Fn&& fn) {
+                emplace_with([&fn]() -> std::decay_t<Fn> { return std::forward<Fn>(fn); }, nullptr);
+            }
+
+            /**
+             * @brief Constructs the task returned by a factory directly in the record, the record must be empty.
+             *
+             * The result of the factory is not moved, so its captures are built in the slot itself.
+             * If the factory throws, the record stays empty.
+             *
+             * @tparam Make Type of the factory.
+             * @param make Returns the task by value.
+             * @param resource Allocates tasks that do not fit inline, nullptr for the built-in pool.
+             */
+            template <typename Make>
+            void emplace_with(Make&& make, std::pmr::memory_resource* resource) {
+                using fn_type = std::invoke_result_t<Make&>;
+                if constexpr (sizeof(fn_type) <= MICROBUS_EVENT_INLINE_SIZE && alignof(fn_type) <= alignof(std::max_align_t)) {
+                    ::new (static_cast<void*>(storage_)) fn_type(make());
+                    run_ = [](void* storage) { (*static_cast<fn_type*>(storage))(); };
+                    destroy_ = [](void* storage) { static_cast<fn_type*>(storage)->~fn_type(); };
+                    if constexpr (std::is_nothrow_move_constructible_v<fn_type>) {
+                        relocate_ = [](void* from, void* to) {
+                            ::new (to) fn_type(std::move(*static_cast<fn_type*>(from)));
+                            static_cast<fn_type*>(from)->~fn_type();
+                        };
+                    } else {
+                        relocate_ = nullptr;
+                    }
+                } else {
+                    struct heap_task {
+                        fn_type* fn_;
+                        std::pmr::memory_resource* resource_;
+                    };
+                    resource = resource_or_pool(resource);
+                    auto* memory = resource->allocate(sizeof(fn_type), alignof(fn_type));
+                    try {
+                        ::new (static_cast<void*>(storage_)) heap_task{::new (memory) fn_type(make()), resource};
+                    } catch (...) {
+                        resource->deallocate(memory, sizeof(fn_type), alignof(fn_type));
+                        throw;
+                    }
+                    run_ = [](void* storage) { (*static_cast<heap_task*>(storage)->fn_)(); };
+                    destroy_ = [](void* storage) {
+                        auto* task = static_cast<heap_task*>(storage);
+                        task->fn_->~fn_type();
+                        task->resource_->deallocate(task->fn_, sizeof(fn_type), alignof(fn_type));
+                    };
+                    relocate_ = [](void* from, void* to) { ::new (to) heap_task(*static_cast<heap_task*>(from)); };
+                }
+            }
+
+            /**
+             * @brief Moves the task into an empty record and leaves this one empty.
+             * @param target The empty record.
+             * @return False if the task cannot be moved without throwing, it then stays in this record.
+             */
+            bool relocate_to(event_record& target) {
+                if (!relocate_) {
+                    return false;
+                }
+                relocate_(storage_, target.storage_);
+                target.run_ = run_;
+                target.destroy_ = std::exchange(destroy_, nullptr);
+                target.relocate_ = relocate_;
+                target.bytes_ = bytes_;
+#if MICROBUS_ENABLE_METRICS
+                target.enqueued_at_ = enqueued_at_;
+#endif
+                return true;
+            }
+
+            /**
+             * @brief Runs the task and empties the record, even if the task throws.
+             */
+            void run() {
+                struct reset_on_exit {
+                    event_record& record_;
+                    ~reset_on_exit() { record_.reset(); }
+                } reset{*this};
+                run_(storage_);
+            }
+
+            /**
+             * @brief Destroys the task without running it.
+             */
+            void reset() {
+                if (destroy_) {
+                    destroy_(storage_);
+                    destroy_ = nullptr;
+                }
+            }
+
+            ~event_record() {
+                reset();
+            }
+
+            std::size_t bytes_ = 0; ///< Bytes charged to the byte budget for the last stored task, set by the ring.
+#if MICROBUS_ENABLE_METRICS
+            std::chrono::steady_clock::time_point enqueued_at_; ///< When the event was published.
+#endif
+
+        private:
+            alignas(std::max_align_t) unsigned char storage_[MICROBUS_EVENT_INLINE_SIZE]; ///< Inline task storage.
+            void (*run_)(void*) = nullptr; ///< Invokes the stored task.
+            void (*destroy_)(void*) = nullptr; ///< Destroys the stored task, nullptr when empty.
+            void (*relocate_)(void*, void*) = nullptr; ///< Moves the stored task to other storage, nullptr if it cannot.
+        };
+
+        /**
+         * @brief Byte limit shared by the queues of a loop.
+         *
+         * An event is charged the size of its packed task, which holds the decayed arguments.
+         * An event larger than the whole capacity never fits, the loop rejects it before it gets here.
+         */
+        class byte_budget {
+        public:
+            /**
+             * @brief Constructs the budget.
+             * @param capacity Maximum number of bytes held at once.
+             */
+            explicit byte_budget(std::size_t capacity) : capacity_(capacity) {}
+
+            /**
+             * @brief Charges up to `count` events of `bytes` each.
+             * @param count Number of events wanted.
+             * @param bytes Bytes per event.
+             * @return Number of events charged, zero if none fits.
+             */
+            std::size_t acquire(std::size_t count, std::size_t bytes) {
+                auto used = used_.load(std::memory_order_relaxed);
+                std::size_t granted;
+                do {
+                    auto room = used < capacity_ ? capacity_ - used : 0;
+                    granted = std::min(count, bytes ? room / bytes : count);
+                    if (granted == 0) {
+                        return 0;
+                    }
+                } while (!used_.compare_exchange_weak(used, used + granted * bytes, std::memory_order_relaxed));
+                return granted;
+            }
+
+            /**
+             * @brief Returns bytes to the budget.
+             * @param bytes The bytes to release.
+             */
+            void release(std::size_t bytes) {
+                if (bytes) {
+                    used_.fetch_sub(bytes);
+                }
+            }
+
+            /**
+             * @brief Checks whether an event would be admitted.
+             * @param bytes Size of the event.
+             * @return True if it fits.
+             */
+            [[nodiscard]] bool fits(std::size_t bytes) const {
+                return used_.load() + bytes <= capacity_;
+            }
+
+            /**
+             * @brief Checks whether an event can ever be admitted.
+             * @param bytes Size of the event.
+             * @return True if it is not larger than the capacity.
+             */
+            [[nodiscard]] bool admits(std::size_t bytes) const {
+                return bytes <= capacity_;
+            }
+
+            /**
+             * @brief Gets the bytes held.
+             * @return The charged bytes.
+             */
+            [[nodiscard]] std::size_t used() const {
+                return used_.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::size_t capacity_; ///< Maximum number of bytes.
+            std::atomic<std::size_t> used_{0}; ///< Bytes charged by queued events.
+        };
+
+        /**
+         * @brief Bounded lock-free queue of event records (Vyukov's sequenced ring).
+         *
+         * Producers claim a slot with one CAS and construct the event in place. Consumers
+         * run the event in its slot and release it afterwards, so nothing is moved or allocated.
+         * A detaching ring instead hands out one event at a time and moves it out of its slot,
+         * freeing the slot before the event runs: a full ring then holds only events nobody has
+         * started, which `discard_oldest` can always drop.
+         */
+        class event_ring {
+        public:
+            /**
+             * @brief Constructs the ring.
+             * @param capacity Minimum number of slots, rounded up to a power of two.
+             * @param in_flight Counter raised by the number of claimed slots before they are published, may be nullptr.
+             * @param budget Byte limit charged for every claimed slot, may be nullptr.
+             * @param resource Allocates events that do not fit a slot, nullptr for the built-in pool.
+             * @param on_error Receives exceptions that escape a task, nullptr to let them leave `run_batch()`.
+             * @param detach Free every slot before its event runs, for `overflow_policy::drop_oldest`.
+             */
+            explicit event_ring(std::size_t capacity, std::atomic<std::size_t>* in_flight = nullptr, byte_budget* budget = nullptr,
+                                std::pmr::memory_resource* resource = nullptr, const std::function<void(std::exception_ptr)>* on_error = nullptr,
+                                bool detach = false)
+                    : in_flight_(in_flight), budget_(budget), resource_(resource_or_pool(resource)), on_error_(on_error), detach_(detach) {
+                std::size_t size = 2;
+                while (size < capacity) {
+                    size <<= 1;
+                }
+                mask_ = size - 1;
+                cells_ = std::make_unique<cell[]>(size);
+                for (std::size_t i = 0; i < size; ++i) {
+                    cells_[i].sequence_.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * @brief Claims a free slot and constructs the task returned by a factory in it.
+             *
+             * The factory is only called once a slot has been claimed. If it throws, the slot is
+             * published as a no-op and the exception is rethrown.
+             *
+             * @tparam Make Type of the factory.
+             * @param make Returns the task by value.
+             * @return False if the ring is full or the byte budget is exhausted.
+             */
+            template <typename Make>
+            bool try_emplace(Make&& make) {
+                constexpr auto bytes = footprint<Make>();
+                if (budget_ && !budget_->acquire(1, bytes)) {
+                    return false;
+                }
+                auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+                cell* target;
+                while (true) {
+                    target = &cells_[pos & mask_];
+                    auto sequence = target->sequence_.load(std::memory_order_acquire);
+                    auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+                    if (diff == 0) {
+                        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        release_bytes(bytes);
+                        return false;
+                    } else {
+                        pos = enqueue_pos_.load(std::memory_order_relaxed);
+                    }
+                }
+                count_in_flight(1);
+                target->record_.bytes_ = budget_ ? bytes : 0;
+#if MICROBUS_ENABLE_METRICS
+                target->record_.enqueued_at_ = std::chrono::steady_clock::now();
+                note_depth(pos + 1);
+#endif
+                try {
+                    target->record_.emplace_with(make, resource_);
+                } catch (...) {
+                    target->record_.emplace([] {});
+                    target->sequence_.store(pos + 1);
+                    throw;
+                }
+                // Sequentially consistent so that the producer's check for a parked consumer cannot miss it.
+                target->sequence_.store(pos + 1);
+                return true;
+            }
+
+            /**
+             * @brief Claims up to `count` consecutive free slots with one CAS and fills them in order.
+             *
+             * If the generator throws, the slots that were not filled yet are published as no-ops
+             * and the exception is rethrown; the events before it stay queued.
+             *
+             * @tparam Gen Type of the generator.
+             * @param count Maximum number of events to push.
+             * @param gen Called once per claimed slot, returns the next task.
+             * @return Number of events pushed, zero if the ring is full.
+             */
+            template <typename Gen>
+            std::size_t try_push_bulk(std::size_t count, Gen&& gen) {
+                constexpr auto bytes = footprint<Gen>();
+                if (budget_ && (count = budget_->acquire(count, bytes)) == 0) {
+                    return 0;
+                }
+                auto wanted = count;
+                auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+                std::size_t claimed;
+                while (true) {
+                    claimed = 0;
+                    while (claimed < count && cells_[(pos + claimed) & mask_].sequence_.load(std::memory_order_acquire) == pos + claimed) {
+                        ++claimed;
+                    }
+                    if (claimed == 0) {
+                        auto sequence = cells_[pos & mask_].sequence_.load(std::memory_order_acquire);
+                        if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos) < 0) {
+                            release_bytes(wanted * bytes);
+                            return 0;
+                        }
+                        pos = enqueue_pos_.load(std::memory_order_relaxed);
+                    } else if (enqueue_pos_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                release_bytes((wanted - claimed) * bytes);
+                count_in_flight(claimed);
+                for (std::size_t i = 0; i < claimed; ++i) {
+                    cells_[(pos + i) & mask_].record_.bytes_ = budget_ ? bytes : 0;
+                }
+#if MICROBUS_ENABLE_METRICS
+                auto now = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < claimed; ++i) {
+                    cells_[(pos + i) & mask_].record_.enqueued_at_ = now;
+                }
+                note_depth(pos + claimed);
+#endif
+                std::size_t filled = 0;
+                try {
+                    for (; filled < claimed; ++filled) {
+                        auto& target = cells_[(pos + filled) & mask_];
+                        target.record_.emplace_with(gen, resource_);
+                        target.sequence_.store(pos + filled + 1);
+                    }
+                } catch (...) {
+                    for (; filled < claimed; ++filled) {
+                        auto& target = cells_[(pos + filled) & mask_];
+                        target.record_.emplace([] {});
+                        target.sequence_.store(pos + filled + 1);
+                    }
+                    throw;
+                }
+                return claimed;
+            }
+
+            /**
+             * @brief Claims up to `max` consecutive published events with one CAS and runs them in place.
+             *
+             * Each slot is freed as soon as its event has run, so producers regain space during the batch.
+             * A detaching ring claims the events one by one instead, see `run_detached`.
+             *
+             * @param max Maximum number of events to run.
+             * @return Number of events run, zero if the ring is empty.
+             */
+            std::size_t run_batch(std::size_t max) {
+                if (detach_) {
+                    return run_detached(max);
+                }
+                auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+                std::size_t claimed;
+                while (true) {
+                    claimed = 0;
+                    while (claimed < max && cells_[(pos + claimed) & mask_].sequence_.load(std::memory_order_acquire) == pos + claimed + 1) {
+                        ++claimed;
+                    }
+                    if (claimed == 0) {
+                        auto sequence = cells_[pos & mask_].sequence_.load(std::memory_order_acquire);
+                        if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1) < 0) {
+                            return 0;
+                        }
+                        pos = dequeue_pos_.load(std::memory_order_relaxed);
+                    } else if (dequeue_pos_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                // Slots still claimed when a task throws are emptied and released without running.
+                struct release_on_exit {
+                    event_ring& ring_;
+                    std::size_t pos_;
+                    std::size_t end_;
+                    ~release_on_exit() {
+                        for (; pos_ != end_; ++pos_) {
+                            auto& target = ring_.cells_[pos_ & ring_.mask_];
+                            target.record_.reset();
+                            ring_.release_bytes(target.record_.bytes_);
+                            target.sequence_.store(pos_ + ring_.mask_ + 1);
+                        }
+                    }
+                } release{*this, pos, pos + claimed};
+                for (; release.pos_ != release.end_; ++release.pos_) {
+                    auto& target = cells_[release.pos_ & mask_];
+                    run_record(target.record_);
+                    release_bytes(target.record_.bytes_);
+                    target.sequence_.store(release.pos_ + mask_ + 1);
+                }
+                return claimed;
+            }
+
+            /**
+             * @brief Claims published events one at a time, moves each out of its slot and frees the slot before running it.
+             *
+             * Costs a CAS per event rather than per batch, but no slot stays occupied by an event that
+             * is already running. Tasks that cannot be moved without throwing run in their slot.
+             *
+             * @param max Maximum number of events to run.
+             * @return Number of events run.
+             */
+            std::size_t run_detached(std::size_t max) {
+                event_record running;
+                std::size_t ran = 0;
+                for (; ran < max; ++ran) {
+                    auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+                    while (true) {
+                        auto sequence = cells_[pos & mask_].sequence_.load(std::memory_order_acquire);
+                        auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+                        if (diff == 0) {
+                            if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                                break;
+                            }
+                        } else if (diff < 0) {
+                            return ran;
+                        } else {
+                            pos = dequeue_pos_.load(std::memory_order_relaxed);
+                        }
+                    }
+                    auto& target = cells_[pos & mask_];
+                    auto* record = &target.record_;
+                    if (target.record_.relocate_to(running)) {
+                        target.sequence_.store(pos + mask_ + 1);
+                        record = &running;
+                    }
+                    // Frees the slot if the event ran in it, and its bytes either way, even if it throws.
+                    struct release_on_exit {
+                        event_ring& ring_;
+                        event_record& record_;
+                        cell& cell_;
+                        std::size_t pos_;
+                        ~release_on_exit() {
+                            ring_.release_bytes(record_.bytes_);
+                            if (&record_ == &cell_.record_) {
+                                cell_.sequence_.store(pos_ + ring_.mask_ + 1);
+                            }
+                        }
+                    } release{*this, *record, target, pos};
+                    run_record(*record);
+                }
+                return ran;
+            }
+
+            /**
+             * @brief Claims the oldest published event and destroys it without running it.
+             *
+             * Slots are reused in order, so while a consumer still runs the event in the slot producers
+             * wait for, discarding a later event would not make room.
+             *
+             * @param unblock Only discard if that frees the slot the next producer needs.
+             * @return True if an event was discarded, false if none was ready or it would not help.
+             */
+            bool discard_oldest(bool unblock) {
+                auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+                while (true) {
+                    auto sequence = cells_[pos & mask_].sequence_.load(std::memory_order_acquire);
+                    auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+                    if (diff == 0) {
+                        if (unblock && pos + mask_ + 1 != enqueue_pos_.load(std::memory_order_relaxed)) {
+                            return false;
+                        }
+                        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        return false;
+                    } else {
+                        pos = dequeue_pos_.load(std::memory_order_relaxed);
+                    }
+                }
+                auto& target = cells_[pos & mask_];
+                target.record_.reset();
+                release_bytes(target.record_.bytes_);
+                target.sequence_.store(pos + mask_ + 1);
+                return true;
+            }
+
+#if defined(__linux__)
+            /**
+             * @brief Places the slots on a NUMA node.
+             * @param node The node.
+             * @throws std::system_error If the kernel rejects the placement.
+             */
+            void prefer_numa_node(int node) {
+                detail::prefer_numa_node(cells_.get(), (mask_ + 1) * sizeof(cell), node);
+            }
+#endif
+
+            /**
+             * @brief Checks whether an event is ready to be run.
+             * @return True if the oldest slot holds a published event.
+             */
+            [[nodiscard]] bool ready() const {
+                auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+                return cells_[pos & mask_].sequence_.load() == pos + 1;
+            }
+
+            /**
+             * @brief Checks whether a producer would find a free slot.
+             * @return True if the next slot is free.
+             */
+            [[nodiscard]] bool writable() const {
+                auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+                return cells_[pos & mask_].sequence_.load() == pos;
+            }
+
+#if MICROBUS_ENABLE_METRICS
+            /**
+             * @brief Gets the depth and high-water mark of the ring.
+             * @return The queue statistics.
+             */
+            [[nodiscard]] queue_metrics metrics() const {
+                auto enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+                auto dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+                return {enqueued > dequeued ? enqueued - dequeued : 0, high_water_.load(std::memory_order_relaxed)};
+            }
+
+            /**
+             * @brief Gets the time events spend queued before they run.
+             * @return The histogram.
+             */
+            [[nodiscard]] const latency_histogram& latency() const {
+                return latency_;
+            }
+#endif
+
+        private:
+            /**
+             * @brief A slot of the ring.
+             */
+            struct cell {
+                std::atomic<std::size_t> sequence_{0}; ///< Publication state of the slot.
+                event_record record_; ///< The event stored in the slot.
+            };
+
+            /**
+             * @brief Runs and empties a record, passing an escaping exception to `on_error_` when there is one.
+             * @param record The record.
+             */
+            void run_record(event_record& record) {
+#if MICROBUS_ENABLE_METRICS
+                auto waited = std::chrono::steady_clock::now() - record.enqueued_at_;
+                latency_.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count()));
+#endif
+                if (on_error_) {
+                    try {
+                        record.run();
+                    } catch (...) {
+                        (*on_error_)(std::current_exception());
+                    }
+                } else {
+                    record.run();
+                }
+            }
+
+            /**
+             * @brief Accounts claimed slots as in flight.
+             * @param count Number of claimed slots.
+             */
+            void count_in_flight(std::size_t count) {
+                if (in_flight_) {
+                    in_flight_->fetch_add(count);
+                }
+            }
+
+            /**
+             * @brief Returns bytes of freed or unclaimed slots to the byte budget.
+             * @param bytes The bytes to release.
+             */
+            void release_bytes(std::size_t bytes) {
+                if (budget_) {
+                    budget_->release(bytes);
+                }
+            }
+
+            /**
+             * @brief Gets the bytes charged for the task built by a factory.
+             * @tparam Make Type of the factory.
+             * @return Size of the task.
+             */
+            template <typename Make>
+            static constexpr std::size_t footprint() {
+                return sizeof(std::remove_reference_t<std::invoke_result_t<std::remove_reference_t<Make>&>>);
+            }
+
+#if MICROBUS_ENABLE_METRICS
+            /**
+             * @brief Raises the high-water mark after a claim.
+             * @param end Position after the last claimed slot.
+             */
+            void note_depth(std::size_t end) {
+                auto dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+                auto depth = end > dequeued ? end - dequeued : 0;
+                auto high = high_water_.load(std::memory_order_relaxed);
+                while (depth > high && !high_water_.compare_exchange_weak(high, depth, std::memory_order_relaxed)) {
+                }
+            }
+#endif
+
+            std::unique_ptr<cell[]> cells_; ///< Preallocated slots.
+            std::atomic<std::size_t>* in_flight_; ///< Counter of queued or running events, may be nullptr.
+            byte_budget* budget_; ///< Byte limit of the loop, may be nullptr.
+            std::pmr::memory_resource* resource_; ///< Allocates events that do not fit a slot.
+            const std::function<void(std::exception_ptr)>* on_error_; ///< Receives exceptions that escape a task, may be nullptr.
+            bool detach_; ///< Whether slots are freed before their events run.
+            std::size_t mask_ = 0; ///< Number of slots minus one.
+            alignas(64) std::atomic<std::size_t> enqueue_pos_{0}; ///< Next slot claimed by producers.
+            alignas(64) std::atomic<std::size_t> dequeue_pos_{0}; ///< Next slot claimed by consumers.
+#if MICROBUS_ENABLE_METRICS
+            alignas(64) std::atomic<std::size_t> high_water_{0}; ///< Largest depth seen by a producer.
+            latency_histogram latency_; ///< Time from publication until an event starts running.
+#endif
+        };
+
+        /**
+         * @brief A type-erased callable run when a timer fires, copies share the callable.
+         *
+         * Sharing lets a periodic timer hand its callback out of the wheel to run outside the timer
+         * mutex while staying armed, without requiring the callable to be copyable.
+         */
+        class timer_callback {
+        public:
+            timer_callback() = default;
+
+            /**
+             * @brief Constructs the callback from a callable.
+             * @tparam Fn Type of the callable.
+             * @param fn The callable, invoked without arguments.
+             */
+            template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, timer_callback>>>
+            explicit timer_callback(Fn&& fn) : impl_(std::make_shared<holder<std::decay_t<Fn>>>(std::forward<Fn>(fn))) {}
+
+            /**
+             * @brief Invokes the callable.
+             */
+            void operator()() { impl_->run(); }
+
+        private:
+            struct base {
+                virtual ~base() = default;
+                virtual void run() = 0;
+            };
+
+            template <typename Fn>
+            struct holder final : base {
+                explicit holder(Fn fn) : fn_(std::move(fn)) {}
+                void run() override { fn_(); }
+                Fn fn_; ///< The callable.
+            };
+
+            std::shared_ptr<base> impl_; ///< The stored callable.
+        };
+
+        /**
+         * @brief Hierarchical timer wheel (Varghese and Lauck) with O(1) insertion and cancellation.
+         *
+         * Four levels of 64 slots cover 2^24 ticks; timers further out are parked at the end of the
+         * wheel and re-placed as it turns. Each slot is an intrusive doubly linked list of nodes stored in
+         * one vector, so arming a timer allocates only when the node pool grows. Deadlines and periods
+         * are kept in nanoseconds and only rounded up to a tick when a timer is placed, so a period that
+         * is not a whole number of ticks keeps its rate. Not thread-safe.
+         */
+        class timer_wheel {
+        public:
+            static constexpr unsigned slot_bits = 6; ///< Slots per level as a power of two.
+            static constexpr unsigned level_count = 4; ///< Number of levels.
+            static constexpr std::uint32_t none = UINT32_MAX; ///< Null node index.
+
+            /**
+             * @brief Constructs an empty wheel.
+             * @param resolution Nanoseconds per tick, at least one.
+             */
+            explicit timer_wheel(std::uint64_t resolution = 1) : resolution_(std::max<std::uint64_t>(resolution, 1)) {
+                std::fill(std::begin(heads_), std::end(heads_), none);
+            }
+
+            /**
+             * @brief Arms a timer.
+             * @param deadline Nanoseconds since tick zero at which the timer fires, the next tick if it already passed.
+             * @param period Nanoseconds between firings, zero for a one-shot timer.
+             * @param fn The callback.
+             * @return The node index and its generation.
+             */
+            std::pair<std::uint32_t, std::uint32_t> add(std::uint64_t deadline, std::uint64_t period, timer_callback fn) {
+                std::uint32_t index;
+                if (!free_.empty()) {
+                    index = free_.back();
+                    free_.pop_back();
+                } else {
+                    index = static_cast<std::uint32_t>(nodes_.size());
+                    nodes_.emplace_back();
+                }
+                auto& n = nodes_[index];
+                n.deadline_ = deadline;
+                n.expiry_ = std::max(tick_after(deadline), now_ + 1);
+                n.period_ = period;
+                n.fn_ = std::move(fn);
+                link(index, now_ + 1);
+                ++size_;
+                return {index, n.generation_};
+            }
+
+            /**
+             * @brief Disarms a timer.
+             * @param index The node index.
+             * @param generation The generation returned by `add`.
+             * @return False if the timer already fired or was cancelled.
+             */
+            bool cancel(std::uint32_t index, std::uint32_t generation) {
+                if (index >= nodes_.size() || nodes_[index].generation_ != generation || nodes_[index].bucket_ == none) {
+                    return false;
+                }
+                unlink(index);
+                release(index);
+                return true;
+            }
+
+            /**
+             * @brief Turns the wheel up to a tick and collects the callbacks of every timer that became due.
+             *
+             * One-shot timers are released and hand over their callback, periodic timers stay armed and
+             * hand over a shared copy, so the caller can run them after releasing its lock.
+             * @param target The tick to advance to.
+             * @param due Receives the callbacks in firing order.
+             */
+            void advance(std::uint64_t target, std::vector<timer_callback>& due) {
+                while (now_ < target) {
+                    if (size_ == 0) {
+                        now_ = target;
+                        return;
+                    }
+                    ++now_;
+                    for (unsigned level = 1; level < level_count && slot_of(now_, level - 1) == 0; ++level) {
+                        cascade(level);
+                    }
+                    auto& head = heads_[slot_of(now_, 0)];
+                    auto index = head;
+                    head = none;
+                    while (index != none) {
+                        auto next = nodes_[index].next_;
+                        auto& n = nodes_[index];
+                        n.bucket_ = none;
+                        if (n.expiry_ > now_) {
+                            // Parked beyond the horizon.
+                            link(index, now_ + 1);
+                        } else if (n.period_) {
+                            due.push_back(n.fn_);
+                            // Periods whose deadline is not after this tick were missed and are skipped.
+                            n.deadline_ += n.period_;
+                            auto reached = now_ * resolution_;
+                            if (n.deadline_ <= reached) {
+                                n.deadline_ += ((reached - n.deadline_) / n.period_ + 1) * n.period_;
+                            }
+                            n.expiry_ = tick_after(n.deadline_);
+                            link(index, now_ + 1);
+                        } else {
+                            due.push_back(std::move(n.fn_));
+                            release(index);
+                        }
+                        index = next;
+                    }
+                }
+            }
+
+            /**
+             * @brief Gets the tick the wheel must be turned to next.
+             * @return The earliest due tick, a cascade tick if no timer is within 64 ticks, or UINT64_MAX without timers.
+             */
+            [[nodiscard]] std::uint64_t next_tick() const {
+                if (size_ == 0) {
+                    return UINT64_MAX;
+                }
+                auto block_end = now_ | (slot_count - 1);
+                for (auto tick = now_ + 1; tick <= block_end; ++tick) {
+                    if (heads_[slot_of(tick, 0)] != none) {
+                        return tick;
+                    }
+                }
+                return block_end + 1;
+            }
+
+            /**
+             * @brief Gets the current tick.
+             * @return The tick the wheel was last turned to.
+             */
+            [[nodiscard]] std::uint64_t now() const { return now_; }
+
+            /**
+             * @brief Gets the number of armed timers.
+             * @return The timer count.
+             */
+            [[nodiscard]] std::size_t size() const { return size_; }
+
+        private:
+            static constexpr std::uint32_t slot_count = 1u << slot_bits; ///< Slots per level.
+            static constexpr std::uint64_t horizon = std::uint64_t{1} << (slot_bits * level_count); ///< Ticks covered by the wheel.
+
+            /**
+             * @brief A timer, linked into one slot.
+             */
+            struct node {
+                std::uint64_t deadline_ = 0; ///< Nanoseconds since tick zero at which the timer is due.
+                std::uint64_t expiry_ = 0; ///< Tick at which the timer fires, the deadline rounded up.
+                std::uint64_t period_ = 0; ///< Nanoseconds between firings, zero for one-shot timers.
+                timer_callback fn_; ///< The callback.
+                std::uint32_t prev_ = none; ///< Previous node in the slot.
+                std::uint32_t next_ = none; ///< Next node in the slot.
+                std::uint32_t bucket_ = none; ///< Slot holding the node, none when disarmed.
+                std::uint32_t generation_ = 1; ///< Incremented whenever the node is released.
+            };
+
+            /**
+             * @brief Gets the first tick that is not before a deadline.
+             * @param deadline Nanoseconds since tick zero.
+             * @return The tick.
+             */
+            std::uint64_t tick_after(std::uint64_t deadline) const {
+                return deadline / resolution_ + (deadline % resolution_ != 0);
+            }
+
+            static std::uint32_t slot_of(std::uint64_t tick, unsigned level) {
+                return static_cast<std::uint32_t>((tick >> (slot_bits * level)) & (slot_count - 1));
+            }
+
+            /**
+             * @brief Links a node into the lowest level whose current revolution contains its expiry.
+             * @param index The node index.
+             * @param base The first tick that has not been processed yet.
+             */
+            void link(std::uint32_t index, std::uint64_t base) {
+                auto& n = nodes_[index];
+                auto placement = std::min(std::max(n.expiry_, base), base | (horizon - 1));
+                unsigned level = 0;
+                while (level + 1 < level_count && (placement >> (slot_bits * (level + 1))) != (base >> (slot_bits * (level + 1)))) {
+                    ++level;
+                }
+                auto bucket = level * slot_count + slot_of(placement, level);
+                n.bucket_ = bucket;
+                n.prev_ = none;
+                n.next_ = heads_[bucket];
+                if (n.next_ != none) {
+                    nodes_[n.next_].prev_ = index;
+                }
+                heads_[bucket] = index;
+            }
+
+            void unlink(std::uint32_t index) {
+                auto& n = nodes_[index];
+                if (n.prev_ != none) {
+                    nodes_[n.prev_].next_ = n.next_;
+                } else {
+                    heads_[n.bucket_] = n.next_;
+                }
+                if (n.next_ != none) {
+                    nodes_[n.next_].prev_ = n.prev_;
+                }
+                n.bucket_ = none;
+            }
+
+            void release(std::uint32_t index) {
+                auto& n = nodes_[index];
+                n.fn_ = timer_callback();
+                n.bucket_ = none;
+                if (++n.generation_ == 0) {
+                    n.generation_ = 1;
+                }
+                free_.push_back(index);
+                --size_;
+            }
+
+            /**
+             * @brief Re-places the timers of the current slot of a level into the lower levels.
+             * @param level The level.
+             */
+            void cascade(unsigned level) {
+                auto& head = heads_[level * slot_count + slot_of(now_, level)];
+                auto index = head;
+                head = none;
+                while (index != none) {
+                    auto next = nodes_[index].next_;
+                    link(index, now_);
+                    index = next;
+                }
+            }
+
+            std::vector<node> nodes_; ///< Node pool, indexed by node index.
+            std::vector<std::uint32_t> free_; ///< Released node indices.
+            std::uint32_t heads_[level_count << slot_bits]; ///< First node of every slot.
+            std::uint64_t resolution_; ///< Nanoseconds per tick.
+            std::uint64_t now_ = 0; ///< Current tick.
+            std::size_t size_ = 0; ///< Number of armed timers.
+        };
+
+        /**
+         * @brief Identity of a conflated value: a topic, its signature and a user key.
+         */
+        struct latest_key {
+            const void* topic_; ///< The topic slot.
+            const void* signature_; ///< The signature of the topic, so a reused slot address cannot alias another type.
+            std::uint64_t key_; ///< The conflation key.
+
+            bool operator==(const latest_key& other) const {
+                return topic_ == other.topic_ && signature_ == other.signature_ && key_ == other.key_;
+            }
+        };
+
+        /**
+         * @brief Hash of a conflation identity.
+         */
+        struct latest_key_hash {
+            std::size_t operator()(const latest_key& k) const {
+                auto h = std::hash<const void*>()(k.topic_);
+                return h ^ (std::hash<std::uint64_t>()(k.key_) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+            }
+        };
+
+        /**
+         * @brief Type-erased owner of a conflated value.
+         */
+        struct latest_value_base {
+            virtual ~latest_value_base() = default;
+        };
+
+        /**
+         * @brief The newest pending arguments of a conflated topic and key.
+         * @tparam Ts Decayed argument types of the topic.
+         */
+        template <typename... Ts>
+        struct latest_value final : latest_value_base {
+            std::optional<std::tuple<Ts...>> value_; ///< The pending arguments, empty once delivered.
+        };
+
+        /**
+         * @brief A locked part of the table of pending conflated values.
+         */
+        struct latest_shard {
+            std::mutex mutex_; ///< Guards the values of the shard.
+            std::unordered_map<latest_key, std::unique_ptr<latest_value_base>, latest_key_hash> values_; ///< Pending values by identity, erased once taken.
+        };
+
+        /**
+         * @brief Claim of the queued event on a conflated value, erases the value when it is taken or the event is discarded unrun.
+         * @tparam Ts Decayed argument types of the topic.
+         */
+        template <typename... Ts>
+        class latest_claim {
+        public:
+            /**
+             * @brief Constructs the claim.
+             * @param shard The shard holding the value.
+             * @param key The identity of the value.
+             */
+            latest_claim(latest_shard& shard, const latest_key& key) : shard_(&shard), key_(key) {}
+
+            latest_claim(latest_claim&& other) noexcept : shard_(std::exchange(other.shard_, nullptr)), key_(other.key_) {}
+            latest_claim& operator=(latest_claim&&) = delete;
+
+            ~latest_claim() {
+                if (shard_) {
+                    std::unique_lock lock(shard_->mutex_);
+                    shard_->values_.erase(key_);
+                }
+            }
+
+            /**
+             * @brief Takes the newest arguments, later values queue a new event.
+             * @return The arguments.
+             */
+            std::optional<std::tuple<Ts...>> take() {
+                std::optional<std::tuple<Ts...>> value;
+                std::unique_lock lock(shard_->mutex_);
+                auto it = shard_->values_.find(key_);
+                value.swap(static_cast<latest_value<Ts...>&>(*it->second).value_);
+                shard_->values_.erase(it);
+                shard_ = nullptr;
+                return value;
+            }
+
+        private:
+            latest_shard* shard_; ///< The shard holding the value, nullptr once taken.
+            latest_key key_; ///< The identity of the value.
+        };
+
+#if MICROBUS_HAS_COROUTINES
+        /**
+         * @brief Queued task that resumes a coroutine, a discarded task resumes it on destruction so it is never leaked.
+         */
+        class resumption {
+        public:
+            explicit resumption(std::coroutine_handle<> handle) : handle_(handle) {}
+            resumption(resumption&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+            resumption& operator=(resumption&&) = delete;
+
+            ~resumption() {
+                if (handle_) {
+                    handle_.resume();
+                }
+            }
+
+            void operator()() {
+                std::exchange(handle_, {}).resume();
+            }
+
+        private:
+            std::coroutine_handle<> handle_; ///< The coroutine, empty once resumed.
+        };
+#endif
+
+        /**
+         * @brief Pending conflated values, sharded by identity to limit lock contention.
+         *
+         * A value exists only while its event is queued, so the table holds at most one entry per
+         * queued conflated event however many keys have been used.
+         */
+        class latest_table {
+        public:
+            static constexpr std::size_t shard_count = 16; ///< Number of independently locked shards.
+
+            using shard = latest_shard;
+
+            /**
+             * @brief Gets the shard of an identity.
+             * @param key The identity.
+             * @return The shard.
+             */
+            shard& shard_of(const latest_key& key) {
+                return shards_[latest_key_hash()(key) % shard_count];
+            }
+
+            /**
+             * @brief Finds the pending value of an identity, the caller must hold the shard mutex.
+             * @tparam Ts Decayed argument types of the topic, matching the signature of the identity.
+             * @param s The shard of the identity.
+             * @param key The identity.
+             * @return The value, or nullptr if no event of the identity is queued.
+             */
+            template <typename... Ts>
+            static latest_value<Ts...>* find(shard& s, const latest_key& key) {
+                auto it = s.values_.find(key);
+                return it != s.values_.end() ? static_cast<latest_value<Ts...>*>(it->second.get()) : nullptr;
+            }
+
+        private:
+            shard shards_[shard_count]; ///< The shards.
+        };
+    }
+
+    /**
+     * @brief A class representing an event loop for processing asynchronous events.
+     *
+     * Events are placed in bounded lock-free rings of preallocated slots, see `event_loop_options`.
+     * Each worker thread owns a ring; when its ring is empty it steals events from the other workers.
+     * Ordered events (`enqueue_ordered`, or every event with `ordered_topics`) go to a per-worker ring
+     * that is never stolen from, so events with the same key run one after another on the same worker.
+     * Unordered events are queued in one of the `priority` lanes; workers drain the high lane first, then
+     * ordered and normal events, then the low lane, and let a waiting lower lane through every
+     * `event_loop_options::starvation_limit` batches.
+     * Producers only touch a mutex to wake a worker that is parked.
+     */
+    class event_loop {
+    public:
+        /**
+         * @brief Constructs an event loop with default options and starts the loop thread.
+         */
+        event_loop() : event_loop(event_loop_options()) {}
+
+        /**
+         * @brief Constructs an event loop with a pool of worker threads.
+         * @param worker_count Number of worker threads, at least one is started.
+         */
+        explicit event_loop(std::size_t worker_count) : event_loop(make_options(worker_count)) {}
+
+        /**
+         * @brief Constructs an event loop and starts its worker threads.
+         * @param options Queue capacity, overflow behavior, worker count and worker placement.
+         * @throws std::invalid_argument If a CPU or the NUMA node of the options does not exist.
+         * @throws std::system_error If the kernel rejects the placement or scheduling of the workers.
+         */
+        explicit event_loop(const event_loop_options& options)
+                : options_(options), stop_flag_(false), threadless_(options.worker_count == 0), timers_(resolution()) {
+            options_.worker_count = std::max<std::size_t>(options_.worker_count, 1);
+            bool pinned = options_.worker_count > 1;
+            if (options_.byte_capacity > 0) {
+                budget_ = std::make_unique<detail::byte_budget>(options_.byte_capacity);
+            }
+            workers_.reserve(options_.worker_count);
+            for (std::size_t i = 0; i < options_.worker_count; ++i) {
+                workers_.push_back(std::make_unique<worker>(options_.capacity, pinned, &in_flight_, budget_.get(), detail::resource_or_pool(options_.memory),
+                                                            options_.on_error ? &options_.on_error : nullptr,
+                                                            options_.on_overflow == overflow_policy::drop_oldest));
+#if defined(__linux__)
+                if (options_.numa_node >= 0) {
+                    workers_.back()->prefer_numa_node(options_.numa_node);
+                }
+#endif
+            }
+            if (threadless_) {
+#if defined(__linux__)
+                ready_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                if (ready_fd_ < 0) {
+                    throw std::system_error(errno, std::system_category(), "microbus: eventfd");
+                }
+#endif
+                return;
+            }
+            for (std::size_t i = 0; i < options_.worker_count; ++i) {
+                workers_[i]->thread_ = std::thread(&event_loop::process_event_loop, this, i);
+            }
+#if defined(__linux__)
+            try {
+                place_workers();
+            } catch (...) {
+                stop();
+                join_workers();
+                throw;
+            }
+#endif
+        }
+
+        event_loop(const event_loop&) = delete;
+        event_loop& operator=(const event_loop&) = delete;
+
+        /**
+         * @brief Destroys the event loop and stops the worker threads.
+         *
+         * A threadless loop runs the events still queued on the calling thread.
+         */
+        ~event_loop() {
+            stop();
+            join_workers();
+            if (threadless_) {
+                while (poll() > 0) {
+                }
+#if defined(__linux__)
+                ::close(ready_fd_);
+#endif
+            }
+        }
+
+        /**
+         * @brief Enqueues an event to be processed asynchronously.
+         * @tparam Args Argument types for the event.
+         * @param bus Shared pointer to the event bus.
+         * @param event_name The name of the event.
+         * @param params The arguments to pass to the event handlers.
+         * @return Whether the event was queued, see `overflow_policy`.
+         * @throws signature_mismatch If the topic exists and is bound to different argument types.
+         */
+        template <typename... Args>
+        enqueue_result enqueue_event(std::shared_ptr<event_bus> &bus, const std::string& event_name, Args&&... params) {
+            if (options_.ordered_topics) {
+                return enqueue_ordered(bus, std::hash<std::string>()(event_name), event_name, std::forward<Args>(params)...);
+            }
+            check_topic<Args...>(bus, event_name);
+            return push_any([&] { return make_task(bus, event_name, std::forward<Args>(params)...); });
+        }
+
+        /**
+         * @brief Enqueues an interned topic to be processed asynchronously.
+         * @tparam Args Argument types of the topic.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return Whether the event was queued, see `overflow_policy`.
+         */
+        template <typename... Args, typename... Params>
+        enqueue_result enqueue_event(std::shared_ptr<event_bus> &bus, const topic_handle<Args...>& topic, Params&&... params) {
+            if (options_.ordered_topics) {
+                return enqueue_ordered(bus, topic.id(), topic, std::forward<Params>(params)...);
+            }
+            return push_any([&] { return make_task(bus, topic, std::forward<Params>(params)...); });
+        }
+
+        /**
+         * @brief Runs a callable on a worker of the loop, which makes the loop an executor for `event_bus::subscribe`.
+         * @tparam Fn Type of the callable, invocable without arguments.
+         * @param task The callable, stored in the queue slot like an event.
+         * @return Whether the task was queued, see `overflow_policy`.
+         */
+        template <typename Fn>
+        enqueue_result post(Fn&& task) {
+            return push_any([&]() -> std::decay_t<Fn> { return std::forward<Fn>(task); });
+        }
+
+        /**
+         * @brief Runs a callable on a worker of the loop once a delay has elapsed.
+         * @tparam Rep Tick type of the delay.
+         * @tparam Period Tick period of the delay.
+         * @tparam Fn Type of the callable, invocable without arguments.
+         * @param delay Time before the callable is queued.
+         * @param task The callable.
+         * @return A handle to cancel the timer, invalid if the loop is stopping.
+         */
+        template <typename Rep, typename Period, typename Fn>
+        timer_handle post_after(const std::chrono::duration<Rep, Period>& delay, Fn&& task) {
+            auto callback = [this, task = std::decay_t<Fn>(std::forward<Fn>(task))]() mutable {
+                push_any([&task]() -> std::decay_t<Fn> { return std::move(task); });
+            };
+            return arm_timer(std::chrono::duration_cast<std::chrono::nanoseconds>(delay), std::chrono::nanoseconds::zero(), std::move(callback));
+        }
+
+        /**
+         * @brief Enqueues an event of an interned topic whose argument is constructed in the queue slot.
+         *
+         * The argument is built from `ctor_args` directly in the preallocated slot (or in the heap
+         * fallback of events larger than `MICROBUS_EVENT_INLINE_SIZE`) and is moved into the last
+         * subscriber, so move-only payloads are never copied.
+         *
+         * @tparam T Argument type of the topic.
+         * @tparam CtorArgs Types of the constructor arguments.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @param ctor_args The arguments to construct the `T` from.
+         * @return Whether the event was queued, see `overflow_policy`.
+         */
+        template <typename T, typename... CtorArgs>
+        enqueue_result emplace_event(std::shared_ptr<event_bus> &bus, const topic_handle<T>& topic, CtorArgs&&... ctor_args) {
+            auto make = [&] {
+                return [bus, slot = topic.slot_, payload = T(std::forward<CtorArgs>(ctor_args)...)]() mutable {
+                    bus->deliver(*slot, payload);
+                };
+            };
+            if (options_.ordered_topics) {
+                return push_pinned(topic.id() % workers_.size(), make);
+            }
+            return push_any(make);
+        }
+
+        /**
+         * @brief Enqueues an event in a priority lane, optionally with a deadline.
+         *
+         * An event that has not started running by its deadline is handled according to
+         * `event_loop_options::on_expired`. With `ordered_topics`, only normal-priority events are ordered.
+         *
+         * @tparam Topic Type of the topic, an event name or a topic handle.
+         * @tparam Params Types of the passed arguments.
+         * @param bus Shared pointer to the event bus.
+         * @param options The lane and deadline of the event.
+         * @param topic The name of the event or the topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return Whether the event was queued, see `overflow_policy`.
+         * @throws signature_mismatch If the topic exists and is bound to different argument types.
+         */
+        template <typename Topic, typename... Params>
+        enqueue_result enqueue_event(std::shared_ptr<event_bus> &bus, const enqueue_options& options, const Topic& topic, Params&&... params) {
+            check_topic<Params...>(bus, topic);
+            if (options.deadline == std::chrono::steady_clock::time_point::max()) {
+                return push_lane(options.lane, topic_key(topic), [&] { return make_task(bus, topic, std::forward<Params>(params)...); });
+            }
+            return push_lane(options.lane, topic_key(topic), [&] { return expiring(options.deadline, make_task(bus, topic, std::forward<Params>(params)...)); });
+        }
+
+        /**
+         * @brief Enqueues an event that is delivered in order with every other event of the same key.
+         * @tparam Args Argument types for the event.
+         * @param bus Shared pointer to the event bus.
+         * @param key The ordering key, events with equal keys run sequentially in enqueue order.
+         * @param event_name The name of the event.
+         * @param params The arguments to pass to the event handlers.
+         * @return Whether the event was queued, see `overflow_policy`.
+         * @throws signature_mismatch If the topic exists and is bound to different argument types.
+         */
+        template <typename... Args>
+        enqueue_result enqueue_ordered(std::shared_ptr<event_bus> &bus, std::size_t key, const std::string& event_name, Args&&... params) {
+            check_topic<Args...>(bus, event_name);
+            return push_pinned(key % workers_.size(), [&] { return make_task(bus, event_name, std::forward<Args>(params)...); });
+        }
+
+        /**
+         * @brief Enqueues an interned topic that is delivered in order with every other event of the same key.
+         * @tparam Args Argument types of the topic.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param key The ordering key, events with equal keys run sequentially in enqueue order.
+         * @param topic The topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return Whether the event was queued, see `overflow_policy`.
+         */
+        template <typename... Args, typename... Params>
+        enqueue_result enqueue_ordered(std::shared_ptr<event_bus> &bus, std::size_t key, const topic_handle<Args...>& topic, Params&&... params) {
+            return push_pinned(key % workers_.size(), [&] { return make_task(bus, topic, std::forward<Params>(params)...); });
+        }
+
+        /**
+         * @brief Enqueues the newest value of an interned topic, replacing a pending one instead of queueing behind it.
+         *
+         * At most one event per topic and key is queued. While it waits, later calls assign their
+         * arguments over the pending ones, so a slow consumer only ever sees the latest value and the
+         * backlog is bounded by the number of distinct topics and keys. If the event cannot be queued,
+         * or is later dropped by `overflow_policy::drop_oldest`, the pending value is discarded.
+         *
+         * @tparam Args Argument types of the topic.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param key The conflation key, values with different keys are kept apart.
+         * @param topic The topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return `conflated` if a pending value was replaced, otherwise whether the event was queued.
+         */
+        template <typename... Args, typename... Params>
+        enqueue_result enqueue_latest(std::shared_ptr<event_bus> &bus, std::uint64_t key, const topic_handle<Args...>& topic, Params&&... params) {
+            detail::latest_key id{topic.slot_, detail::signature_of<Args...>(), key};
+            auto& shard = latest_.shard_of(id);
+            {
+                std::unique_lock lock(shard.mutex_);
+                if (auto* pending = detail::latest_table::find<Args...>(shard, id)) {
+                    *pending->value_ = std::forward_as_tuple(std::forward<Params>(params)...);
+                    return enqueue_result::conflated;
+                }
+                auto fresh = std::make_unique<detail::latest_value<Args...>>();
+                fresh->value_.emplace(std::forward<Params>(params)...);
+                shard.values_.emplace(id, std::move(fresh));
+            }
+            // Moved into the event once it is queued, otherwise it erases the value when it goes out of scope.
+            detail::latest_claim<Args...> claim(shard, id);
+            return push_lane(priority::normal, topic.id(), [&] {
+                return [bus, slot = topic.slot_, claim = std::move(claim)]() mutable {
+                    auto value = claim.take();
+                    if (value) {
+                        std::apply([&](Args&... unpacked) { bus->deliver(*slot, unpacked...); }, *value);
+                    }
+                };
+            });
+        }
+
+        /**
+         * @brief Enqueues the newest value of an interned topic, replacing a pending one.
+         * @tparam Args Argument types of the topic.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return `conflated` if a pending value was replaced, otherwise whether the event was queued.
+         */
+        template <typename... Args, typename... Params>
+        enqueue_result enqueue_latest(std::shared_ptr<event_bus> &bus, const topic_handle<Args...>& topic, Params&&... params) {
+            return enqueue_latest(bus, 0, topic, std::forward<Params>(params)...);
+        }
+
+        /**
+         * @brief Enqueues an event once a delay has elapsed.
+         *
+         * The arguments are packed when the timer is armed. Timers live in a hierarchical timer wheel
+         * turned by the first worker, so arming and cancelling cost O(1) regardless of how many are
+         * pending; they fire with `event_loop_options::timer_resolution` granularity and never early.
+         * Pending timers are not waited for by `wait_until_finished`, and are discarded by `stop()`.
+         *
+         * @tparam Rep Tick type of the delay.
+         * @tparam Period Tick period of the delay.
+         * @tparam Topic Type of the topic, an event name or a topic handle.
+         * @tparam Params Types of the passed arguments.
+         * @param bus Shared pointer to the event bus.
+         * @param delay Time to wait before the event is queued.
+         * @param topic The name of the event or the topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return A handle to cancel the timer, invalid if the loop is stopping.
+         * @throws signature_mismatch If the topic exists and is bound to different argument types.
+         */
+        template <typename Rep, typename Period, typename Topic, typename... Params>
+        timer_handle enqueue_after(std::shared_ptr<event_bus> &bus, const std::chrono::duration<Rep, Period>& delay, const Topic& topic, Params&&... params) {
+            check_topic<Params...>(bus, topic);
+            auto key = topic_key(topic);
+            auto callback = [this, key, task = make_task(bus, topic, std::forward<Params>(params)...)]() mutable {
+                push_lane(priority::normal, key, [&task] { return std::move(task); });
+            };
+            return arm_timer(std::chrono::duration_cast<std::chrono::nanoseconds>(delay), std::chrono::nanoseconds::zero(), std::move(callback));
+        }
+
+        /**
+         * @brief Enqueues an event every time a period elapses, starting one period from now.
+         *
+         * The arguments are packed once and copied into every event. A periodic timer keeps a fixed
+         * rate: if the loop falls behind, missed periods are skipped rather than delivered in a burst.
+         *
+         * @tparam Rep Tick type of the period.
+         * @tparam Period Tick period of the period.
+         * @tparam Topic Type of the topic, an event name or a topic handle.
+         * @tparam Params Types of the passed arguments, copyable.
+         * @param bus Shared pointer to the event bus.
+         * @param period Time between events.
+         * @param topic The name of the event or the topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return A handle to cancel the timer, invalid if the loop is stopping.
+         * @throws signature_mismatch If the topic exists and is bound to different argument types.
+         */
+        template <typename Rep, typename Period, typename Topic, typename... Params>
+        timer_handle schedule_every(std::shared_ptr<event_bus> &bus, const std::chrono::duration<Rep, Period>& period, const Topic& topic, Params&&... params) {
+            check_topic<Params...>(bus, topic);
+            auto key = topic_key(topic);
+            auto task = make_task(bus, topic, std::forward<Params>(params)...);
+            static_assert(std::is_copy_constructible_v<decltype(task)>, "periodic event arguments must be copyable");
+            auto callback = [this, key, task = std::move(task)] {
+                push_lane(priority::normal, key, [&task] { return task; });
+            };
+            auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(period);
+            return arm_timer(interval, interval, std::move(callback));
+        }
+
+        /**
+         * @brief Cancels a delayed or periodic event.
+         * @param timer The timer handle.
+         * @return False if the timer already fired, was cancelled, or the handle is invalid.
+         */
+        bool cancel_timer(const timer_handle& timer) {
+            if (!timer.valid()) {
+                return false;
+            }
+            std::unique_lock lock(timer_mutex_);
+            return timers_.cancel(timer.index_, timer.generation_);
+        }
+
+        /**
+         * @brief Gets the number of armed timers.
+         * @return The count of delayed events not yet queued and periodic events not cancelled.
+         */
+        [[nodiscard]] std::size_t pending_timers() const {
+            std::unique_lock lock(timer_mutex_);
+            return timers_.size();
+        }
+
+        /**
+         * @brief Enqueues one event of an interned topic per element of a range.
+         *
+         * Consecutive slots are claimed with a single CAS per worker queue and the loop is woken
+         * once per claim instead of once per event. Elements are converted to the topic arguments;
+         * for topics with several arguments each element is a tuple-like of them.
+         *
+         * @tparam Args Argument types of the topic.
+         * @tparam Range Type of the range.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @param range The event arguments.
+         * @return Number of events queued, less than the range size if the overflow policy dropped or rejected some.
+         */
+        template <typename... Args, typename Range>
+        std::size_t enqueue_batch(std::shared_ptr<event_bus> &bus, const topic_handle<Args...>& topic, Range&& range) {
+            using std::begin;
+            using std::end;
+            auto first = begin(range);
+            auto last = end(range);
+            auto remaining = static_cast<std::size_t>(std::distance(first, last));
+            auto gen = [&bus, &topic, &first] {
+                decltype(auto) element = *first;
+                ++first;
+                if constexpr (sizeof...(Args) == 1) {
+                    return make_task(bus, topic, std::forward<decltype(element)>(element));
+                } else {
+                    return std::apply([&bus, &topic](auto&&... unpacked) {
+                        return make_task(bus, topic, std::forward<decltype(unpacked)>(unpacked)...);
+                    }, std::forward<decltype(element)>(element));
+                }
+            };
+            if (options_.ordered_topics) {
+                return push_bulk_pinned(topic.id() % workers_.size(), remaining, gen);
+            }
+            return push_bulk_any(remaining, gen);
+        }
+
+        /**
+         * @brief Gets the number of worker threads.
+         * @return The worker count, zero for a threadless loop.
+         */
+        [[nodiscard]] std::size_t worker_count() const {
+            return threadless_ ? 0 : workers_.size();
+        }
+
+        /**
+         * @brief Gets a descriptor that becomes readable when a threadless loop has events to poll.
+         *
+         * It is an eventfd for `epoll`, `io_uring` or any other reactor. `poll` resets it, and it is
+         * signaled again while events remain; a reactor still has to wake for timers at `next_timer()`.
+         *
+         * @return The descriptor, -1 for a loop with threads or outside Linux.
+         */
+        [[nodiscard]] int readiness_fd() const {
+            return ready_fd_;
+        }
+
+        /**
+         * @brief Gets the time the next timer of the loop is due.
+         * @return The due time, `time_point::max()` if no timer is armed.
+         */
+        [[nodiscard]] std::chrono::steady_clock::time_point next_timer() const {
+            auto due = timer_due_.load();
+            if (due == UINT64_MAX) {
+                return std::chrono::steady_clock::time_point::max();
+            }
+            return timer_origin_ + std::chrono::nanoseconds(due * resolution());
+        }
+
+        /**
+         * @brief Runs ready events and due timers of a threadless loop on the calling thread, without blocking.
+         *
+         * Events run in the order the workers of a single-threaded loop would run them. Only one thread
+         * may poll, run or wait on a threadless loop at a time.
+         *
+         * @param max_events Maximum number of events to run.
+         * @return Number of events run.
+         * @throws std::logic_error If the loop runs worker threads.
+         */
+        std::size_t poll(std::size_t max_events = SIZE_MAX) {
+            if (!threadless_) {
+                throw std::logic_error("microbus: poll needs an event loop without worker threads");
+            }
+            clear_ready();
+            auto* previous = current_loop();
+            current_loop() = this;
+            std::size_t total = 0;
+            service_timers();
+            while (total < max_events) {
+                auto ran = run_batch(0, max_events - total);
+                if (!ran) {
+                    break;
+                }
+                total += ran;
+                finish_batch(*workers_[0], ran);
+            }
+            current_loop() = previous;
+            if (has_work(0)) {
+                signal_ready();
+            }
+            return total;
+        }
+
+        /**
+         * @brief Runs the events of a threadless loop on the calling thread until a timeout expires or the loop stops.
+         *
+         * Parks between events like a worker thread, and returns early once the loop is stopped and
+         * has no events left.
+         *
+         * @tparam Rep Tick type of the timeout.
+         * @tparam Period Tick period of the timeout.
+         * @param timeout How long to run.
+         * @return Number of events run.
+         * @throws std::logic_error If the loop runs worker threads.
+         */
+        template <typename Rep, typename Period>
+        std::size_t run_for(const std::chrono::duration<Rep, Period>& timeout) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+            auto& self = *workers_[0];
+            std::size_t total = 0;
+            while (true) {
+                total += poll();
+                if (std::chrono::steady_clock::now() >= deadline || (stop_flag_.load() && !has_work(0))) {
+                    return total;
+                }
+                std::unique_lock lock(self.mutex_);
+                self.parked_.store(true);
+                parked_workers_.fetch_add(1);
+                auto ready = [this] { return stop_flag_.load() || has_work(0) || timer_rearm_.load(); };
+                self.condition_.wait_until(lock, std::min(deadline, next_timer()), ready);
+                parked_workers_.fetch_sub(1);
+                self.parked_.store(false);
+            }
+        }
+
+        /**
+         * @brief Waits until every queued event, including events queued meanwhile, has finished running.
+         *
+         * A threadless loop runs the events on the calling thread instead.
+         */
+        void wait_until_finished() {
+            if (threadless_) {
+                while (in_flight_.load() != 0) {
+                    if (poll() == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                return;
+            }
+            waiter_scope scope(waiters_);
+#if defined(__cpp_lib_atomic_wait)
+            for (auto pending = in_flight_.load(); pending != 0; pending = in_flight_.load()) {
+                in_flight_.wait(pending);
+            }
+#else
+            std::unique_lock lock(wait_mutex_);
+            wait_condition_.wait(lock, [this] { return in_flight_.load() == 0; });
+#endif
+        }
+
+        /**
+         * @brief Waits until every queued event has finished running, or the timeout expires.
+         * @tparam Rep Tick type of the timeout.
+         * @tparam Period Tick period of the timeout.
+         * @param timeout Maximum time to wait.
+         * @return True if the loop became idle, false on timeout.
+         */
+        template <typename Rep, typename Period>
+        bool wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+            if (threadless_) {
+                auto deadline = std::chrono::steady_clock::now() + timeout;
+                while (in_flight_.load() != 0) {
+                    if (std::chrono::steady_clock::now() >= deadline) {
+                        return false;
+                    }
+                    if (poll() == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                return true;
+            }
+            waiter_scope scope(waiters_);
+            std::unique_lock lock(wait_mutex_);
+            return wait_condition_.wait_for(lock, timeout, [this] { return in_flight_.load() == 0; });
+        }
+
+        /**
+         * @brief Gets the number of events queued or running.
+         * @return The in-flight count.
+         */
+        [[nodiscard]] std::size_t in_flight() const {
+            return in_flight_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the number of events whose deadline passed before they started running.
+         * @return The expired count, including events run late with `expiry_policy::run`.
+         */
+        [[nodiscard]] std::size_t expired() const {
+            return expired_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the number of events discarded because a queue or the byte budget was full, or lost by a throwing timer.
+         * @return The dropped count of `overflow_policy::drop_oldest` and `overflow_policy::drop_newest`, and of timer firings that threw.
+         */
+        [[nodiscard]] std::size_t dropped() const {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Takes a snapshot of the queue statistics.
+         *
+         * Without `MICROBUS_ENABLE_METRICS` the snapshot is empty.
+         *
+         * @return Event counts, per-queue depth and high-water mark, and the enqueue-to-run latency.
+         */
+        [[nodiscard]] loop_metrics metrics() const {
+            loop_metrics out;
+#if MICROBUS_ENABLE_METRICS
+            out.enqueued = enqueued_.load(0);
+            out.dropped = dropped_.load(std::memory_order_relaxed);
+            out.queued_bytes = budget_ ? budget_->used() : 0;
+            std::vector<std::uint64_t> counts(detail::latency_histogram::bucket_count);
+            for (const auto& w : workers_) {
+                out.processed += w->processed_.load(std::memory_order_relaxed);
+                for (const auto& lane : w->lanes_) {
+                    out.queues.push_back(lane->metrics());
+                    lane->latency().merge_into(counts, out.queue_latency_ns);
+                }
+                if (w->pinned_) {
+                    out.queues.push_back(w->pinned_->metrics());
+                    w->pinned_->latency().merge_into(counts, out.queue_latency_ns);
+                }
+            }
+            detail::latency_histogram::finish(counts, out.queue_latency_ns);
+#endif
+            return out;
+        }
+
+#if MICROBUS_HAS_COROUTINES
+        /**
+         * @brief Awaitable returned by `schedule`.
+         */
+        class schedule_awaitable {
+        public:
+            [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                return loop_->resume_later(handle);
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+            friend class event_loop;
+
+            explicit schedule_awaitable(event_loop& loop) : loop_(&loop) {}
+
+            event_loop* loop_; ///< The loop to resume on.
+        };
+
+        /**
+         * @brief Moves the awaiting coroutine onto a worker of the loop.
+         *
+         * The continuation is queued in the normal lane without allocating. If the loop does not
+         * accept it, because it is stopping or its queue is full under a non-blocking overflow policy,
+         * the coroutine continues on the current thread.
+         *
+         * @return The awaitable.
+         */
+        [[nodiscard]] schedule_awaitable schedule() {
+            return schedule_awaitable(*this);
+        }
+
+        /**
+         * @brief Gets an awaitable for the next event of an interned topic, resumed on a worker of the loop.
+         * @tparam Args Argument types of the topic.
+         * @param bus Shared pointer to the event bus that owns the topic, it must outlive the suspension.
+         * @param topic The topic handle.
+         * @return The awaitable.
+         */
+        template <typename... Args>
+        [[nodiscard]] next_event<Args...> next([[maybe_unused]] const std::shared_ptr<event_bus> &bus, const topic_handle<Args...>& topic) {
+            static_assert(std::is_copy_constructible_v<std::tuple<Args...>>, "microbus: awaited topics need copyable arguments");
+            return next_event<Args...>(*topic.slot_, &resume_on, this);
+        }
+#endif
+
+        /**
+         * @brief Enqueues an event and returns a future that completes once its handlers have run.
+         *
+         * An exception thrown by a handler is stored in the future instead of leaving the loop thread.
+         * If the event is not queued, the future holds a `std::future_error` with `broken_promise`.
+         *
+         * @tparam Topic Type of the topic, an event name or a topic handle.
+         * @tparam Params Types of the passed arguments.
+         * @param bus Shared pointer to the event bus.
+         * @param topic The name of the event or the topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return The completion future of this event.
+         * @throws signature_mismatch If the topic exists and is bound to different argument types.
+         */
+        template <typename Topic, typename... Params>
+        std::future<void> enqueue_tracked(std::shared_ptr<event_bus> &bus, const Topic& topic, Params&&... params) {
+            check_topic<Params...>(bus, topic);
+            std::promise<void> promise(std::allocator_arg, std::pmr::polymorphic_allocator<std::byte>(detail::resource_or_pool(options_.memory)));
+            auto future = promise.get_future();
+            // The promise is left behind, and broken, if no slot is claimed.
+            push_lane(priority::normal, topic_key(topic), [&] {
+                return [inner = make_task(bus, topic, std::forward<Params>(params)...), promise = std::move(promise)]() mutable {
+                    try {
+                        inner();
+                        promise.set_value();
+                    } catch (...) {
+                        promise.set_exception(std::current_exception());
+                    }
+                };
+            });
+            return future;
+        }
+
+        /**
+         * @brief Triggers an interned topic and calls its subscribers in parallel on the workers of the loop.
+         *
+         * The arguments are packed once and every subscriber receives the same copy as lvalues, so handlers
+         * must not modify them. One task per worker is queued, and each claims the next subscriber not yet
+         * called until none is left, so the event takes about as long as its slowest subscriber rather than
+         * the sum of all of them. Subscribers bound to an executor are posted as by `trigger`. When the loop
+         * queues none of the tasks, the subscribers are called on the calling thread; when it discards all
+         * of them, the subscribers left are skipped. Subscribers removed before their turn are skipped too.
+         * It may be called from a handler running on this loop: that worker queues one task fewer and claims
+         * subscribers as well, so waiting on the future from the handler does not deadlock.
+         *
+         * @tparam Args Argument types of the topic.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return A future that is ready once every subscriber has returned. Under `error_policy::propagate`
+         *         it carries the first exception a handler threw, other policies handle errors as `trigger` does.
+         * @throws std::logic_error If a subscriber takes ownership of arguments that cannot be copied.
+         */
+        template <typename... Args, typename... Params>
+        std::future<void> trigger_parallel(std::shared_ptr<event_bus> &bus, const topic_handle<Args...>& topic, Params&&... params) {
+            using state_type = detail::fan_out<Args...>;
+            auto* slot = topic.slot_;
+            auto* memory = detail::resource_or_pool(options_.memory);
+            auto state = std::allocate_shared<state_type>(std::pmr::polymorphic_allocator<state_type>(memory), bus, slot, memory, std::forward<Params>(params)...);
+            auto future = state->done_.get_future();
+            {
+                detail::epoch_guard guard;
+                auto* handlers = static_cast<const detail::subscriber_list<Args...>*>(slot->handlers_.load());
+                if (handlers && !handlers->targets(state->targets_)) {
+                    throw std::logic_error("microbus: trigger_parallel shares the arguments, but a handler takes ownership of them");
+                }
+                state->remaining_.store(state->targets_.size(), std::memory_order_relaxed);
+                event_bus::count_publish(*slot, handlers);
+                std::apply([slot](Args&... unpacked) { detail::waiting_coroutines waiting(*slot, unpacked...); }, state->args_);
+                if (handlers && !handlers->remote_.empty()) {
+                    std::shared_ptr<const std::tuple<Args...>> payload(state, &state->args_);
+                    for (const auto& subscriber : handlers->remote_) {
+                        subscriber.post_(payload);
+                    }
+                }
+            }
+            // A worker of this loop claims subscribers itself, so the event completes even when the other
+            // workers are busy or its own queue holds the tasks.
+            bool on_worker = current_loop() == this;
+            bool queued = false;
+            for (std::size_t i = 0, parts = std::min(state->targets_.size(), workers_.size() - on_worker); i < parts; ++i) {
+                auto result = push_any([&] {
+                    return [part = detail::fan_out_part<Args...>(state)]() mutable { part.state().bus_->run_fan_out(part.state()); };
+                });
+                queued = queued || result == enqueue_result::queued;
+            }
+            if (on_worker || !queued) {
+                bus->run_fan_out(*state);
+            }
+            state->finish();
+            return future;
+        }
+
+        /**
+         * @brief Stops the event loop.
+         *
+         * Events already queued are still processed, producers blocked on a full queue are released.
+         */
+        void stop() {
+            stop_flag_.store(true);
+            for (auto& w : workers_) {
+                wake(*w);
+            }
+            signal_ready();
+            {
+                std::unique_lock lock(space_mutex_);
+            }
+            space_condition_.notify_all();
+        }
+
+    private:
+        /**
+         * @brief A worker thread together with its queues and parking state.
+         */
+        struct worker {
+            /**
+             * @brief Constructs the queues of a worker.
+             * @param capacity Slots per queue.
+             * @param pinned Whether to create the queue for ordered events.
+             * @param in_flight The loop's counter of queued or running events.
+             * @param budget The loop's byte limit, may be nullptr.
+             * @param resource Allocates events that do not fit a slot.
+             * @param on_error Receives exceptions that escape an event, may be nullptr.
+             * @param detach Whether the queues free slots before their events run.
+             */
+            worker(std::size_t capacity, bool pinned, std::atomic<std::size_t>* in_flight, detail::byte_budget* budget,
+                   std::pmr::memory_resource* resource, const std::function<void(std::exception_ptr)>* on_error, bool detach)
+                    : pinned_(pinned ? std::make_unique<detail::event_ring>(capacity, in_flight, budget, resource, on_error, detach) : nullptr) {
+                for (auto& lane : lanes_) {
+                    lane = std::make_unique<detail::event_ring>(capacity, in_flight, budget, resource, on_error, detach);
+                }
+            }
+
+            /**
+             * @brief Gets the queue of a priority lane.
+             * @param lane The lane.
+             * @return The queue.
+             */
+            detail::event_ring& lane(priority lane) {
+                return *lanes_[static_cast<std::size_t>(lane)];
+            }
+
+            /**
+             * @brief Gets the queue for ordered events, which is the normal lane of a single worker.
+             * @return The queue.
+             */
+            detail::event_ring& pinned() {
+                return pinned_ ? *pinned_ : lane(priority::normal);
+            }
+
+#if defined(__linux__)
+            /**
+             * @brief Places the queues on a NUMA node.
+             * @param node The node.
+             */
+            void prefer_numa_node(int node) {
+                for (auto& lane : lanes_) {
+                    lane->prefer_numa_node(node);
+                }
+                if (pinned_) {
+                    pinned_->prefer_numa_node(node);
+                }
+            }
+#endif
+
+            std::unique_ptr<detail::event_ring> lanes_[priority_count]; ///< Events any worker may run, one queue per priority.
+            std::unique_ptr<detail::event_ring> pinned_; ///< Ordered events only this worker runs.
+            std::size_t streak_ = 0; ///< Consecutive batches run while a lower lane was waiting, owned by the worker thread.
+            std::size_t boost_ = 0; ///< Rotates the lower lane served when the streak reaches the starvation limit.
+            std::mutex mutex_; ///< Mutex guarding the parking of the worker.
+            std::condition_variable condition_; ///< Condition variable the worker parks on.
+            std::atomic<bool> parked_{false}; ///< Whether the worker is waiting for events.
+            std::thread thread_; ///< Thread running the worker.
+#if MICROBUS_ENABLE_METRICS
+            std::atomic<std::uint64_t> processed_{0}; ///< Events run by this worker.
+#endif
+        };
+
+        event_loop_options options_; ///< Construction options.
+        std::unique_ptr<detail::byte_budget> budget_; ///< Byte limit of all queues, null without `byte_capacity`.
+        std::vector<std::unique_ptr<worker>> workers_; ///< Worker threads and their queues.
+        alignas(64) std::atomic<std::size_t> next_worker_{0}; ///< Round-robin cursor for unordered events.
+        std::atomic<std::size_t> parked_workers_{0}; ///< Number of parked workers, they are woken to steal.
+        std::mutex space_mutex_; ///< Mutex guarding producers waiting for a free slot.
+        std::condition_variable space_condition_; ///< Condition variable for free slot notifications.
+        std::atomic<int> producers_parked_{0}; ///< Number of producers waiting for a free slot.
+        std::atomic<bool> stop_flag_; ///< Flag to stop the event loop.
+        bool threadless_; ///< Whether the loop has no worker threads and is run by `poll`.
+        int ready_fd_ = -1; ///< Eventfd signaled when a threadless loop has events, -1 otherwise.
+        std::atomic<bool> ready_signaled_{false}; ///< Whether `ready_fd_` was signaled since the last poll.
+
+        alignas(64) std::atomic<std::size_t> in_flight_{0}; ///< Events claimed by producers and not yet finished.
+        std::atomic<std::size_t> expired_{0}; ///< Events that missed their deadline.
+        std::atomic<std::size_t> dropped_{0}; ///< Events discarded by the overflow policy.
+
+        mutable std::mutex timer_mutex_; ///< Mutex guarding the timer wheel.
+        detail::timer_wheel timers_; ///< Delayed and periodic events, turned by the first worker.
+        std::vector<detail::timer_callback> timer_firing_; ///< Spare buffer of due callbacks, keeps its capacity between turns.
+        std::chrono::steady_clock::time_point timer_origin_ = std::chrono::steady_clock::now(); ///< Time of tick zero.
+        std::atomic<std::uint64_t> timer_due_{UINT64_MAX}; ///< Tick at which the first worker next turns the wheel.
+        std::atomic<bool> timer_rearm_{false}; ///< Set when a timer was armed before `timer_due_`.
+
+        detail::latest_table latest_; ///< Pending values of conflated topics.
+        std::atomic<std::size_t> waiters_{0}; ///< Threads waiting for the loop to become idle.
+        std::mutex wait_mutex_; ///< Mutex for wait operations.
+        std::condition_variable wait_condition_; ///< Condition variable for wait notifications.
+#if MICROBUS_ENABLE_METRICS
+        detail::sharded_counters<1> enqueued_; ///< Events accepted by the loop.
+#endif
+
+        /**
+         * @brief Registers a waiter for the duration of a wait.
+         */
+        struct waiter_scope {
+            explicit waiter_scope(std::atomic<std::size_t>& waiters) : waiters_(waiters) { waiters_.fetch_add(1); }
+            ~waiter_scope() { waiters_.fetch_sub(1); }
+            std::atomic<std::size_t>& waiters_; ///< The waiter count.
+        };
+
+        /**
+         * @brief Marks events as finished and wakes waiters when the loop becomes idle.
+         * @param count Number of finished events.
+         */
+        void complete(std::size_t count) {
+            if (in_flight_.fetch_sub(count) == count && waiters_.load() > 0) {
+                {
+                    std::unique_lock lock(wait_mutex_);
+                }
+                wait_condition_.notify_all();
+#if defined(__cpp_lib_atomic_wait)
+                in_flight_.notify_all();
+#endif
+            }
+        }
+
+        /**
+         * @brief Counts accepted events, a no-op without metrics.
+         * @param count Number of events.
+         */
+        void count_enqueued([[maybe_unused]] std::size_t count) {
+#if MICROBUS_ENABLE_METRICS
+            enqueued_.add(0, count);
+#endif
+        }
+
+        /**
+         * @brief Joins the worker threads after `stop`.
+         */
+        void join_workers() {
+            for (auto& w : workers_) {
+                if (w->thread_.joinable())
+                    w->thread_.join();
+            }
+        }
+
+#if defined(__linux__)
+        /**
+         * @brief Applies the placement, scheduling and naming options to the worker threads.
+         * @throws std::invalid_argument If a CPU or the NUMA node does not exist.
+         * @throws std::system_error If the affinity or the scheduling parameters are rejected.
+         */
+        void place_workers() {
+            auto cpus = options_.cpus;
+            if (cpus.empty() && options_.numa_node >= 0) {
+                cpus = detail::numa_node_cpus(options_.numa_node);
+            }
+            for (std::size_t i = 0; i < workers_.size(); ++i) {
+                std::vector<int> own;
+                if (options_.pin_workers && !cpus.empty()) {
+                    own.push_back(cpus[i % cpus.size()]);
+                }
+                auto name = options_.thread_name;
+                if (!name.empty() && workers_.size() > 1) {
+                    auto suffix = "-" + std::to_string(i);
+                    name = name.substr(0, 15 - std::min<std::size_t>(suffix.size(), 15)) + suffix;
+                }
+                detail::configure_thread(workers_[i]->thread_, own.empty() ? cpus : own, options_.sched_policy, options_.sched_priority, name);
+            }
+        }
+#endif
+
+        /**
+         * @brief Builds options for a worker pool.
+         * @param worker_count Number of worker threads.
+         * @return The options.
+         */
+        static event_loop_options make_options(std::size_t worker_count) {
+            event_loop_options options;
+            options.worker_count = worker_count;
+            return options;
+        }
+
+        /**
+         * @brief Converts a time to a timer wheel tick, rounding down.
+         * @param time The time.
+         * @return The tick.
+         */
+        std::uint64_t tick_of(std::chrono::steady_clock::time_point time) const {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(time - timer_origin_).count();
+            return elapsed > 0 ? static_cast<std::uint64_t>(elapsed) / resolution() : 0;
+        }
+
+        /**
+         * @brief Gets the timer wheel tick length.
+         * @return Nanoseconds per tick, at least one.
+         */
+        std::uint64_t resolution() const {
+            return static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(options_.timer_resolution.count(), 1));
+        }
+
+        /**
+         * @brief Arms a timer and wakes the first worker if it fires before the worker's next wake-up.
+         * @tparam Callback Type of the callback.
+         * @param delay Time until the first firing.
+         * @param period Time between firings, zero for a one-shot timer.
+         * @param callback Queues the event.
+         * @return The timer handle, invalid if the loop is stopping.
+         */
+        template <typename Callback>
+        timer_handle arm_timer(std::chrono::nanoseconds delay, std::chrono::nanoseconds period, Callback&& callback) {
+            auto since_origin = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - timer_origin_ + delay).count();
+            auto deadline = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(since_origin, 0));
+            // The wheel rounds the deadline up to a tick, so a timer never fires early.
+            auto expiry = deadline / resolution() + (deadline % resolution() != 0);
+            auto period_ns = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(period.count(), 0));
+            std::pair<std::uint32_t, std::uint32_t> armed;
+            {
+                std::unique_lock lock(timer_mutex_);
+                if (stop_flag_.load()) {
+                    return {};
+                }
+                armed = timers_.add(deadline, period_ns, detail::timer_callback(std::forward<Callback>(callback)));
+                if (expiry >= timer_due_.load()) {
+                    return {armed.first, armed.second};
+                }
+                timer_due_.store(expiry);
+                timer_rearm_.store(true);
+            }
+            wake(*workers_[0]);
+            signal_ready();
+            return {armed.first, armed.second};
+        }
+
+        /**
+         * @brief Turns the timer wheel to the current time and queues the events of due timers.
+         *
+         * Called by the first worker between batches, it only reads the clock while timers are armed.
+         * The callbacks run after the timer mutex is released, so discarding a task that arms a timer
+         * cannot deadlock. A firing whose callback throws loses its event: it is counted as dropped
+         * and passed to `event_loop_options::on_error`.
+         */
+        void service_timers() {
+            auto due = timer_due_.load(std::memory_order_relaxed);
+            if (due == UINT64_MAX && !timer_rearm_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            auto now = tick_of(std::chrono::steady_clock::now());
+            if (now < due && !timer_rearm_.load()) {
+                return;
+            }
+            std::vector<detail::timer_callback> firing;
+            {
+                std::unique_lock lock(timer_mutex_);
+                timer_rearm_.store(false);
+                firing.swap(timer_firing_);
+                timers_.advance(now, firing);
+                timer_due_.store(timers_.next_tick());
+                if (firing.empty()) {
+                    timer_firing_.swap(firing);
+                    return;
+                }
+            }
+            for (auto& fire : firing) {
+                try {
+                    fire();
+                } catch (...) {
+                    // The event of this firing is lost, the timer stays armed if periodic.
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    if (options_.on_error) {
+                        options_.on_error(std::current_exception());
+                    }
+                }
+            }
+            // Released outside the mutex too, a one-shot callback may own tasks that arm timers when destroyed.
+            firing.clear();
+            std::unique_lock lock(timer_mutex_);
+            timer_firing_.swap(firing);
+        }
+
+        /**
+         * @brief Gets the loop whose worker runs on the calling thread.
+         * @return The loop, or nullptr on other threads.
+         */
+        static const event_loop*& current_loop() {
+            thread_local const event_loop* loop = nullptr;
+            return loop;
+        }
+
+#if MICROBUS_HAS_COROUTINES
+        /**
+         * @brief Queues the resumption of a coroutine.
+         * @param handle The suspended coroutine.
+         * @return False if the loop did not accept it and the caller has to resume it.
+         */
+        bool resume_later(std::coroutine_handle<> handle) {
+            return push_any([handle] { return detail::resumption(handle); }) == enqueue_result::queued;
+        }
+
+        /**
+         * @brief Resumes a coroutine on a worker of a loop, or inline if the loop does not accept it.
+         * @param loop The loop.
+         * @param handle The suspended coroutine.
+         */
+        static void resume_on(void* loop, std::coroutine_handle<> handle) {
+            if (!static_cast<event_loop*>(loop)->resume_later(handle)) {
+                handle.resume();
+            }
+        }
+#endif
+
+        /**
+         * @brief Checks the argument types of a named event before it is queued.
+         * @tparam Args Argument types for the event.
+         * @param bus Shared pointer to the event bus.
+         * @param event_name The name of the event.
+         * @throws signature_mismatch If the topic exists and is bound to different argument types.
+         */
+        template <typename... Args>
+        static void check_topic(const std::shared_ptr<event_bus> &bus, const std::string& event_name) {
+            bus->check_enqueue(event_name, detail::signature_of<Args...>());
+        }
+
+        /**
+         * @brief Interned topics were checked when their handle was created.
+         */
+        template <typename... Params, typename... Args>
+        static void check_topic(const std::shared_ptr<event_bus> &, const topic_handle<Args...>&) {}
+
+        /**
+         * @brief Packs a named event into a task, its signature must have been checked.
+         * @tparam Args Argument types for the event.
+         * @param bus Shared pointer to the event bus.
+         * @param event_name The name of the event.
+         * @param params The arguments to pass to the event handlers.
+         * @return The task, holding the bus, the name and the decayed arguments by value.
+         */
+        template <typename... Args>
+        static auto make_task(std::shared_ptr<event_bus> &bus, const std::string& event_name, Args&&... params) {
+            return [bus, event_name, tuple_args = std::tuple<std::decay_t<Args>...>(std::forward<Args>(params)...)]() mutable {
+                bus->trigger_impl(event_name, tuple_args);
+            };
+        }
+
+        /**
+         * @brief Packs an interned topic event into a task.
+         * @tparam Args Argument types of the topic.
+         * @tparam Params Types of the passed arguments, converted to the topic argument types.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @param params The arguments to pass to the event handlers.
+         * @return The task, holding the bus, the topic slot and the arguments by value.
+         */
+        template <typename... Args, typename... Params>
+        static auto make_task(std::shared_ptr<event_bus> &bus, const topic_handle<Args...>& topic, Params&&... params) {
+            return [bus, slot = topic.slot_, tuple_args = std::tuple<Args...>(std::forward<Params>(params)...)]() mutable {
+                std::apply([&](Args&... unpacked) { bus->deliver(*slot, unpacked...); }, tuple_args);
+            };
+        }
+
+        /**
+         * @brief Wraps a task so that it is expired if it starts running after a deadline.
+         * @tparam Task Type of the task.
+         * @param deadline The deadline.
+         * @param task The task.
+         * @return The wrapped task.
+         */
+        template <typename Task>
+        auto expiring(std::chrono::steady_clock::time_point deadline, Task task) {
+            return [this, deadline, task = std::move(task)]() mutable {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    expired_.fetch_add(1, std::memory_order_relaxed);
+                    if (options_.on_expired == expiry_policy::drop) {
+                        return;
+                    }
+                }
+                task();
+            };
+        }
+
+        /**
+         * @brief Places a task in a priority lane, or in its ordered queue for normal events with `ordered_topics`.
+         * @tparam Make Type of the task factory.
+         * @param lane The priority lane.
+         * @param key The ordering key of the topic, see `topic_key`.
+         * @param make Returns the task, called once a slot has been claimed.
+         * @return Whether the task was queued.
+         */
+        template <typename Make>
+        enqueue_result push_lane(priority lane, std::size_t key, Make&& make) {
+            if (lane == priority::normal && options_.ordered_topics) {
+                return push_pinned(key % workers_.size(), make);
+            }
+            return push_any(make, lane);
+        }
+
+        /**
+         * @brief Gets the ordering key of a named topic.
+         * @param event_name The name of the event.
+         * @return The key.
+         */
+        static std::size_t topic_key(const std::string& event_name) {
+            return std::hash<std::string>()(event_name);
+        }
+
+        /**
+         * @brief Gets the ordering key of an interned topic.
+         * @param topic The topic handle.
+         * @return The key.
+         */
+        template <typename... Args>
+        static std::size_t topic_key(const topic_handle<Args...>& topic) {
+            return topic.id();
+        }
+
+        /**
+         * @brief Places a task in the first worker queue with a free slot, starting round-robin.
+         * @tparam Make Type of the task factory.
+         * @param make Returns the task, called once a slot has been claimed.
+         * @param lane The priority lane.
+         * @return Whether the task was queued.
+         */
+        template <typename Make>
+        enqueue_result push_any(Make&& make, priority lane = priority::normal) {
+            if (stop_flag_.load(std::memory_order_relaxed) || !admits(footprint<Make>())) {
+                return enqueue_result::rejected;
+            }
+            auto count = workers_.size();
+            auto start = count == 1 ? 0 : next_worker_.fetch_add(1, std::memory_order_relaxed);
+            while (true) {
+                // The task is only built once a slot has been claimed, directly inside it.
+                for (std::size_t i = 0; i < count; ++i) {
+                    auto& target = *workers_[(start + i) % count];
+                    if (target.lane(lane).try_emplace(make)) {
+                        count_enqueued(1);
+                        notify_pushed(target, true);
+                        return enqueue_result::queued;
+                    }
+                }
+                if (auto result = on_full(workers_[start % count]->lane(lane), footprint<Make>())) {
+                    return *result;
+                }
+            }
+        }
+
+        /**
+         * @brief Places a task in the ordered queue of a worker.
+         * @tparam Make Type of the task factory.
+         * @param index The worker index.
+         * @param make Returns the task, called once a slot has been claimed.
+         * @return Whether the task was queued.
+         */
+        template <typename Make>
+        enqueue_result push_pinned(std::size_t index, Make&& make) {
+            if (stop_flag_.load(std::memory_order_relaxed) || !admits(footprint<Make>())) {
+                return enqueue_result::rejected;
+            }
+            auto& target = *workers_[index];
+            while (!target.pinned().try_emplace(make)) {
+                if (auto result = on_full(target.pinned(), footprint<Make>())) {
+                    return *result;
+                }
+            }
+            count_enqueued(1);
+            notify_pushed(target, workers_.size() == 1);
+            return enqueue_result::queued;
+        }
+
+        /**
+         * @brief Places `count` generated tasks in the worker queues, claiming runs of slots at once.
+         * @tparam Gen Type of the task generator.
+         * @param count Number of tasks.
+         * @param gen Returns the next task on each call.
+         * @return Number of tasks queued.
+         */
+        template <typename Gen>
+        std::size_t push_bulk_any(std::size_t count, Gen& gen) {
+            if (stop_flag_.load(std::memory_order_relaxed) || !admits(footprint<Gen>())) {
+                return 0;
+            }
+            auto workers = workers_.size();
+            auto start = workers == 1 ? 0 : next_worker_.fetch_add(1, std::memory_order_relaxed);
+            std::size_t queued = 0;
+            while (queued < count) {
+                bool progress = false;
+                for (std::size_t i = 0; i < workers && queued < count; ++i) {
+                    auto& target = *workers_[(start + i) % workers];
+                    if (auto pushed = target.lane(priority::normal).try_push_bulk(count - queued, gen)) {
+                        queued += pushed;
+                        progress = true;
+                        count_enqueued(pushed);
+                        notify_pushed(target, true);
+                    }
+                }
+                if (!progress && on_full(workers_[start % workers]->lane(priority::normal), footprint<Gen>())) {
+                    break;
+                }
+            }
+            return queued;
+        }
+
+        /**
+         * @brief Places `count` generated tasks in the ordered queue of a worker, claiming runs of slots at once.
+         * @tparam Gen Type of the task generator.
+         * @param index The worker index.
+         * @param count Number of tasks.
+         * @param gen Returns the next task on each call.
+         * @return Number of tasks queued.
+         */
+        template <typename Gen>
+        std::size_t push_bulk_pinned(std::size_t index, std::size_t count, Gen& gen) {
+            if (stop_flag_.load(std::memory_order_relaxed) || !admits(footprint<Gen>())) {
+                return 0;
+            }
+            auto& target = *workers_[index];
+            std::size_t queued = 0;
+            while (queued < count) {
+                if (auto pushed = target.pinned().try_push_bulk(count - queued, gen)) {
+                    queued += pushed;
+                    count_enqueued(pushed);
+                    notify_pushed(target, workers_.size() == 1);
+                } else if (on_full(target.pinned(), footprint<Gen>())) {
+                    break;
+                }
+            }
+            return queued;
+        }
+
+        /**
+         * @brief Gets the bytes a task built by a factory is charged against the byte budget.
+         * @tparam Make Type of the factory.
+         * @return Size of the task.
+         */
+        template <typename Make>
+        static constexpr std::size_t footprint() {
+            return sizeof(std::invoke_result_t<std::remove_reference_t<Make>&>);
+        }
+
+        /**
+         * @brief Checks whether the byte budget can ever hold an event.
+         * @param bytes Size of the event.
+         * @return False if it is larger than `byte_capacity`.
+         */
+        [[nodiscard]] bool admits(std::size_t bytes) const {
+            return !budget_ || budget_->admits(bytes);
+        }
+
+        /**
+         * @brief Applies the overflow policy to a full queue or an exhausted byte budget.
+         *
+         * With `drop_oldest` the oldest ready event of the full queue is discarded, or of any queue
+         * when the byte budget is what ran out. Workers free each slot before running its event, so
+         * only a worker that is just taking the oldest event can leave nothing to discard; the new
+         * event is dropped instead in that race.
+         *
+         * @param ring The queue that rejected the event.
+         * @param bytes Size of the event.
+         * @return The result to report, or nothing to retry the push.
+         */
+        std::optional<enqueue_result> on_full(detail::event_ring& ring, std::size_t bytes) {
+            switch (options_.on_overflow) {
+                case overflow_policy::drop_oldest:
+                    if (stop_flag_.load()) {
+                        return enqueue_result::rejected;
+                    }
+                    if (discard_oldest(ring)) {
+                        return std::nullopt;
+                    }
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return enqueue_result::dropped;
+                case overflow_policy::drop_newest:
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return enqueue_result::dropped;
+                case overflow_policy::fail:
+                    return enqueue_result::rejected;
+                case overflow_policy::block:
+                    break;
+            }
+            // Blocking from a worker of this loop could never be released.
+            if (current_loop() == this || !wait_for_space(ring, bytes)) {
+                return enqueue_result::rejected;
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Discards the oldest ready event to make room for a new one.
+         * @param ring The queue that rejected the new event, tried first.
+         * @return True if an event was discarded.
+         */
+        bool discard_oldest(detail::event_ring& ring) {
+            bool writable = ring.writable();
+            bool discarded = ring.discard_oldest(!writable);
+            if (!discarded && budget_ && writable) {
+                for (auto& w : workers_) {
+                    for (auto& lane : w->lanes_) {
+                        if ((discarded = lane->discard_oldest(false))) {
+                            break;
+                        }
+                    }
+                    if (discarded || (w->pinned_ && (discarded = w->pinned_->discard_oldest(false)))) {
+                        break;
+                    }
+                }
+            }
+            if (discarded) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                complete(1);
+            }
+            return discarded;
+        }
+
+        /**
+         * @brief Wakes the worker that received an event, or a parked worker that may steal it.
+         * @param target The worker that received the event.
+         * @param stealable Whether other workers may run the event.
+         */
+        void notify_pushed(worker& target, bool stealable) {
+            signal_ready();
+            if (target.parked_.load()) {
+                wake(target);
+            } else if (stealable && parked_workers_.load() > 0) {
+                for (auto& w : workers_) {
+                    if (w->parked_.load()) {
+                        wake(*w);
+                        break;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Wakes a parked worker.
+         * @param w The worker.
+         */
+        static void wake(worker& w) {
+            {
+                std::unique_lock lock(w.mutex_);
+            }
+            w.condition_.notify_one();
+        }
+
+        /**
+         * @brief Parks a producer until a slot is freed and the byte budget admits the event.
+         * @param ring The full queue.
+         * @param bytes Size of the event.
+         * @return False if the loop is stopping.
+         */
+        bool wait_for_space(const detail::event_ring& ring, std::size_t bytes) {
+            std::unique_lock lock(space_mutex_);
+            producers_parked_.fetch_add(1);
+            space_condition_.wait(lock, [this, &ring, bytes] {
+                return stop_flag_.load() || (ring.writable() && (!budget_ || budget_->fits(bytes)));
+            });
+            producers_parked_.fetch_sub(1);
+            return !stop_flag_.load();
+        }
+
+        /**
+         * @brief Runs a batch of events of a worker, stealing one event from the other workers when it has none.
+         *
+         * The worker's own queues are drained in priority order: the high lane, the ordered queue,
+         * the normal lane and the low lane. After `starvation_limit` consecutive batches that left a
+         * lower queue waiting, the next lower queue in rotation is served first.
+         *
+         * @param index The worker index.
+         * @param limit Maximum number of events to run.
+         * @return Number of events run, zero if no event was found.
+         */
+        std::size_t run_batch(std::size_t index, std::size_t limit = SIZE_MAX) {
+            auto& self = *workers_[index];
+            auto batch = std::min(std::max<std::size_t>(options_.batch_size, 1), limit);
+            detail::event_ring* queues[] = {self.lanes_[0].get(), self.pinned_.get(), self.lanes_[1].get(), self.lanes_[2].get()};
+            constexpr std::size_t queue_count = std::size(queues);
+
+            if (self.streak_ >= std::max<std::size_t>(options_.starvation_limit, 1)) {
+                self.streak_ = 0;
+                for (std::size_t i = 0; i < queue_count - 1; ++i) {
+                    auto* queue = queues[1 + (self.boost_ + i) % (queue_count - 1)];
+                    if (queue) {
+                        if (auto ran = queue->run_batch(batch)) {
+                            self.boost_ = (self.boost_ + i + 1) % (queue_count - 1);
+                            return ran;
+                        }
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < queue_count; ++i) {
+                if (!queues[i]) {
+                    continue;
+                }
+                if (auto ran = queues[i]->run_batch(batch)) {
+                    bool waiting = std::any_of(queues + i + 1, queues + queue_count, [](const detail::event_ring* q) { return q && q->ready(); });
+                    self.streak_ = waiting ? self.streak_ + 1 : 0;
+                    return ran;
+                }
+            }
+            for (std::size_t lane = 0; lane < priority_count; ++lane) {
+                for (std::size_t i = 1; i < workers_.size(); ++i) {
+                    if (auto ran = workers_[(index + i) % workers_.size()]->lanes_[lane]->run_batch(1)) {
+                        return ran;
+                    }
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * @brief Checks whether a worker can find an event to run.
+         * @param index The worker index.
+         * @return True if its own queues or any stealable queue has a published event.
+         */
+        bool has_work(std::size_t index) const {
+            auto& self = *workers_[index];
+            if (self.pinned_ && self.pinned_->ready()) {
+                return true;
+            }
+            return std::any_of(workers_.begin(), workers_.end(), [](const auto& w) {
+                return std::any_of(std::begin(w->lanes_), std::end(w->lanes_), [](const auto& lane) { return lane->ready(); });
+            });
+        }
 
         /**
-         * @brief Invokes the handler with the provided arguments.
-         * @param args Pointer to the arguments.
+         * @brief Processes the event loop of one worker by handling events in the queues.
+         * @param index The worker index.
          */
-        virtual void invoke(void* args) = 0;
-    };
+        void process_event_loop(std::size_t index) {
+            current_loop() = this;
+            auto& self = *workers_[index];
+            std::size_t idle_polls = 0;
+            while (true) {
+                if (index == 0) {
+                    service_timers();
+                }
+                auto ran = run_batch(index);
+                if (!ran) {
+                    // Producers do not wake a worker that has not parked, it finds their events by polling.
+                    if (idle_polls < options_.idle.spin + options_.idle.yield && !stop_flag_.load(std::memory_order_relaxed)) {
+                        if (idle_polls++ < options_.idle.spin) {
+                            detail::spin_pause();
+                        } else {
+                            std::this_thread::yield();
+                        }
+                        continue;
+                    }
+                    idle_polls = 0;
+                    std::unique_lock lock(self.mutex_);
+                    self.parked_.store(true);
+                    parked_workers_.fetch_add(1);
+                    auto ready = [this, index] { return stop_flag_.load() || has_work(index) || (index == 0 && timer_rearm_.load()); };
+                    auto due = index == 0 ? timer_due_.load() : UINT64_MAX;
+                    if (due != UINT64_MAX) {
+                        self.condition_.wait_until(lock, timer_origin_ + std::chrono::nanoseconds(due * resolution()), ready);
+                    } else {
+                        self.condition_.wait(lock, ready);
+                    }
+                    parked_workers_.fetch_sub(1);
+                    self.parked_.store(false);
+
+                    if (stop_flag_.load() && !has_work(index)) {
+                        break;
+                    }
+                    continue;
+                }
+
+                idle_polls = 0;
+                finish_batch(self, ran);
+            }
+        }
 
-    /**
-     * @brief A concrete handler that binds a function to a given set of arguments.
-     * @tparam Fn Type of the function.
-     * @tparam Args Argument types.
-     */
-    template<typename Fn, typename... Args>
-    struct concrete_handler : type_erased_handler {
         /**
-         * @brief Constructs a concrete handler.
-         * @param fn The function to be handled.
+         * @brief Releases producers waiting for space and accounts for a batch that ran.
+         * @param self The worker that ran the batch.
+         * @param ran Number of events run.
          */
-        explicit concrete_handler(Fn&& fn) : fn_(std::forward<Fn>(fn)) {}
+        void finish_batch([[maybe_unused]] worker& self, std::size_t ran) {
+            if (producers_parked_.load() > 0) {
+                {
+                    std::unique_lock lock(space_mutex_);
+                }
+                space_condition_.notify_all();
+            }
+#if MICROBUS_ENABLE_METRICS
+            self.processed_.store(self.processed_.load(std::memory_order_relaxed) + ran, std::memory_order_relaxed);
+#endif
+            // Waiters are only woken when the last in-flight event of the loop finishes.
+            complete(ran);
+        }
 
         /**
-         * @brief Invokes the handler with the provided arguments.
-         * @param args Pointer to the arguments.
+         * @brief Signals the readiness descriptor of a threadless loop once until the next poll.
          */
-        void invoke(void* args) override {
-            auto tuple_args = static_cast<std::tuple<Args...>*>(args);
-            std::apply(fn_, *tuple_args);
+        void signal_ready() {
+#if defined(__linux__)
+            if (ready_fd_ >= 0 && !ready_signaled_.exchange(true)) {
+                std::uint64_t one = 1;
+                [[maybe_unused]] auto written = ::write(ready_fd_, &one, sizeof(one));
+            }
+#endif
         }
 
-        Fn fn_; ///< The function to be invoked.
+        /**
+         * @brief Resets the readiness descriptor before a poll looks for events.
+         */
+        void clear_ready() {
+#if defined(__linux__)
+            if (ready_signaled_.exchange(false)) {
+                std::uint64_t count;
+                [[maybe_unused]] auto drained = ::read(ready_fd_, &count, sizeof(count));
+            }
+#endif
+        }
     };
 
+    namespace detail {
+        template <typename Fn>
+        bool post_after(event_loop& loop, std::chrono::nanoseconds delay, Fn&& fn) {
+            return loop.post_after(delay, std::forward<Fn>(fn)).valid();
+        }
+    }
+
     /**
-     * @brief A class representing an event bus for managing subscriptions and event notifications.
+     * @brief A topic declared as a type for `static_event_bus`, derive from it to name a topic.
+     *
+     * A derived topic may redefine `capacity` to bound its subscribers: their slots are then
+     * reserved when the bus is constructed and subscribing past the bound throws.
+     *
+     * @tparam Args Argument types of the topic.
      */
-    class event_bus : public std::enable_shared_from_this<event_bus> {
-    public:
-        template <typename... Args>
-        using event_handler = std::function<void(Args...)>;
+    template <typename... Args>
+    struct static_topic {
+        static_assert((std::is_same_v<Args, std::decay_t<Args>> && ...), "static_topic arguments must be value types");
+
+        static constexpr std::size_t capacity = 0; ///< Maximum number of subscribers, zero for no limit.
+    };
 
+    namespace detail {
         /**
-         * @brief Subscribes to an event with a given handler.
-         * @tparam Args Argument types for the handler.
-         * @param event_name The name of the event.
-         * @param handler The handler to be called when the event is triggered.
-         * @return A subscription ID.
+         * @brief Deduces the arguments of a topic type from its `static_topic` base.
+         * @tparam Args Argument types of the topic.
+         * @return Nothing, only used in unevaluated context.
          */
         template <typename... Args>
-        int subscribe(const std::string& event_name, event_handler<Args...> handler) {
-            std::unique_lock lock(mutex_);
-            int id = next_id_++;
-
-            auto concreteHandler = std::make_unique<concrete_handler<event_handler<Args...>, Args...>>(std::move(handler));
-            subscribers_[event_name].emplace_back(id, std::move(concreteHandler));
-            return id;
-        }
+        std::tuple<Args...> static_topic_args(const static_topic<Args...>*);
 
         /**
-         * @brief Unsubscribes from an event.
-         * @param event_name The name of the event.
-         * @param id The subscription ID.
+         * @brief The subscribers of one compile-time topic.
+         * @tparam Topic The topic type.
+         * @tparam Ts Argument types of the topic.
          */
-        void unsubscribe(const std::string& event_name, int id) {
-            std::unique_lock lock(mutex_);
-            if (subscribers_.count(event_name)) {
-                auto& handlers = subscribers_[event_name];
-                handlers.erase(
-                        std::remove_if(
-                                handlers.begin(), handlers.end(),
-                                [id](const auto& pair) { return pair.first == id; }
-                        ),
-                        handlers.end()
-                );
-                if (handlers.empty()) {
-                    subscribers_.erase(event_name);
+        template <typename Topic, typename... Ts>
+        struct static_slot {
+            using list_type = subscriber_list<Ts...>;
+
+            static_slot() {
+                if constexpr (Topic::capacity > 0) {
+                    handlers_.store(new list_type(Topic::capacity), std::memory_order_relaxed);
                 }
             }
-        }
 
-        /**
-         * @brief Triggers an event and calls all subscribed handlers.
-         * @tparam Args Argument types for the event.
-         * @param event_name The name of the event.
-         * @param params The arguments to pass to the handlers.
-         */
-        template <typename... Args>
-        void trigger(const std::string& event_name, Args&&... params) {
-            std::shared_lock lock(mutex_);
-            if (subscribers_.count(event_name)) {
-                auto tuple_args = std::make_tuple(std::forward<Args>(params)...);
-                for (const auto& [id, handler] : subscribers_[event_name]) {
-                    handler->invoke(&tuple_args);
-                }
+            static_slot(const static_slot&) = delete;
+            static_slot& operator=(const static_slot&) = delete;
+
+            ~static_slot() {
+                delete handlers_.load(std::memory_order_relaxed);
             }
-        }
+
+            std::atomic<const list_type*> handlers_{nullptr}; ///< Current subscriber snapshot, nullptr when empty.
+            std::mutex mutex_; ///< Serializes subscription changes of the topic.
+        };
 
         /**
-         * @brief Clears all subscriptions.
+         * @brief Maps a topic type to its slot type.
+         * @tparam Topic The topic type.
+         * @tparam Args Argument tuple of the topic.
          */
-        void clear() {
-            std::unique_lock lock(mutex_);
-            subscribers_.clear();
-        }
-
-    private:
-        using handler_ptr = std::unique_ptr<type_erased_handler>;
-        std::unordered_map<std::string, std::vector<std::pair<int, handler_ptr>>> subscribers_; ///< Container for event subscribers.
-        mutable std::shared_mutex mutex_; ///< Mutex for thread safety.
+        template <typename Topic, typename Args = decltype(static_topic_args(static_cast<Topic*>(nullptr)))>
+        struct static_slot_of;
 
-        friend class event_loop;
+        template <typename Topic, typename... Ts>
+        struct static_slot_of<Topic, std::tuple<Ts...>> {
+            using type = static_slot<Topic, Ts...>;
+        };
 
         /**
-         * @brief Internal method to trigger an event.
-         * @param event_name The name of the event.
-         * @param args Pointer to the arguments.
+         * @brief Finds the position of a type in a pack at compile time.
+         * @tparam T The type.
+         * @tparam Ts The pack.
+         * @return The index, or the pack size if the type is absent.
          */
-        void trigger_impl(const std::string& event_name, void* args) {
-            std::shared_lock lock(mutex_);
-            if (subscribers_.count(event_name)) {
-                for (const auto& [id, handler] : subscribers_[event_name]) {
-                    handler->invoke(args);
-                }
+        template <typename T, typename... Ts>
+        constexpr std::size_t index_of() {
+            constexpr bool matches[] = {std::is_same_v<T, Ts>..., false};
+            std::size_t index = 0;
+            while (index < sizeof...(Ts) && !matches[index]) {
+                ++index;
             }
+            return index;
         }
-
-        int next_id_ = 0; ///< The next subscription ID.
-    };
+    }
 
     /**
-     * @brief A class representing an event loop for processing asynchronous events.
+     * @brief An event bus whose topics are types known at compile time.
+     *
+     * Each topic type names a slot in a tuple, so `subscribe<Topic>` and `trigger<Topic>` resolve
+     * their subscribers without a lookup, and arguments that do not match the topic fail to
+     * compile. Subscribers are kept in the same append-in-place snapshots as on `event_bus`, so
+     * triggering never locks and handlers may subscribe or unsubscribe re-entrantly.
+     *
+     * @tparam Topics Topic types, each deriving from `static_topic`.
      */
-    class event_loop {
+    template <typename... Topics>
+    class static_event_bus {
+        template <typename Topic>
+        using args_of = decltype(detail::static_topic_args(static_cast<Topic*>(nullptr)));
+
+        template <typename Topic>
+        static constexpr std::size_t index_of() {
+            constexpr auto index = detail::index_of<Topic, Topics...>();
+            static_assert(index < sizeof...(Topics), "microbus: the topic is not part of this static_event_bus");
+            return index;
+        }
+
     public:
-        /**
-         * @brief Constructs an event loop and starts the loop thread.
-         */
-        event_loop() : stop_flag_(false), event_loop_thread_(&event_loop::process_event_loop, this) {}
+        static_event_bus() = default;
+        static_event_bus(const static_event_bus&) = delete;
+        static_event_bus& operator=(const static_event_bus&) = delete;
+
+        ~static_event_bus() {
+            detail::epoch_domain::instance().collect();
+        }
 
         /**
-         * @brief Destroys the event loop and stops the loop thread.
+         * @brief Subscribes a handler to a topic.
+         * @tparam Topic The topic type.
+         * @tparam Fn Type of the callable, invocable with the topic's arguments as lvalues.
+         * @param handler Function to handle the event.
+         * @return A subscription ID.
+         * @throws std::length_error If the topic has `capacity` subscribers.
+         * @throws std::logic_error If the current last subscriber takes ownership of move-only arguments.
          */
-        ~event_loop() {
-            stop();
-            if (event_loop_thread_.joinable())
-                event_loop_thread_.join();
+        template <typename Topic, typename Fn>
+        int subscribe(Fn&& handler) {
+            return subscribe_to<Topic>(std::forward<Fn>(handler), args_of<Topic>());
         }
 
         /**
-         * @brief Enqueues an event to be processed asynchronously.
-         * @tparam Args Argument types for the event.
-         * @param bus Shared pointer to the event bus.
-         * @param event_name The name of the event.
-         * @param params The arguments to pass to the event handlers.
+         * @brief Unsubscribes a handler from a topic.
+         * @tparam Topic The topic type.
+         * @param id The subscription ID.
          */
-        template <typename... Args>
-        void enqueue_event(std::shared_ptr<event_bus> &bus, const std::string& event_name, Args&&... params) {
-            auto tuple_args = std::make_shared<std::tuple<std::decay_t<Args>...>>(std::forward<Args>(params)...);
-            {
-                std::unique_lock lock(queue_mutex_);
-                async_event_queue_.emplace([bus, event_name, tuple_args] {
-                    bus->trigger_impl(event_name, tuple_args.get());
-                });
+        template <typename Topic>
+        void unsubscribe(int id) {
+            auto& slot = std::get<index_of<Topic>()>(slots_);
+            std::unique_lock lock(slot.mutex_);
+            using list_type = typename std::remove_reference_t<decltype(slot)>::list_type;
+            auto* current = const_cast<list_type*>(slot.handlers_.load(std::memory_order_relaxed));
+            if (!current) {
+                return;
+            }
+            // Only the slot's writer mutates a published snapshot, tombstones are atomic flags readers skip.
+            auto* next = static_cast<const list_type*>(current->remove(id));
+            if constexpr (Topic::capacity > 0) {
+                if (next != current) {
+                    // Keep room for `capacity` subscribers instead of dropping to an empty or compact snapshot.
+                    auto reserved = next ? next->compacted(Topic::capacity) : std::make_unique<list_type>(Topic::capacity);
+                    delete next;
+                    next = reserved.release();
+                }
+            }
+            if (next != current) {
+                publish(slot, next);
             }
-            queue_condition_.notify_one();
         }
 
         /**
-         * @brief Waits until all events in the queue are processed.
+         * @brief Triggers a topic, calling its handlers on this thread.
+         * @tparam Topic The topic type.
+         * @tparam Params Types of the arguments, each must construct the matching argument of the topic.
+         * @param params The arguments, moved into the last handler.
          */
-        void wait_until_finished() {
-            std::unique_lock lock(wait_mutex_);
-            wait_condition_.wait(lock, [this] {
-                std::unique_lock q_lock(queue_mutex_);
-                return async_event_queue_.empty();
-            });
+        template <typename Topic, typename... Params>
+        void trigger(Params&&... params) {
+            trigger_with<Topic>(args_of<Topic>(), std::forward<Params>(params)...);
         }
 
         /**
-         * @brief Stops the event loop.
+         * @brief Queues an event of a topic on an event loop, the bus must outlive the queued event.
+         * @tparam Topic The topic type.
+         * @tparam Params Types of the arguments, each must construct the matching argument of the topic.
+         * @param loop The event loop.
+         * @param params The arguments, stored in the queue slot.
+         * @return The outcome of queueing the event.
          */
-        void stop() {
-            {
-                std::unique_lock lock(queue_mutex_);
-                stop_flag_ = true;
-            }
-            queue_condition_.notify_all();
+        template <typename Topic, typename... Params>
+        enqueue_result enqueue(event_loop& loop, Params&&... params) {
+            using tuple_type = args_of<Topic>;
+            return loop.post([this, args = tuple_type(std::forward<Params>(params)...)]() mutable {
+                std::apply([this](auto&... unpacked) { deliver<Topic>(unpacked...); }, args);
+            });
         }
 
     private:
-        std::queue<std::function<void()>> async_event_queue_; ///< Queue for asynchronous events.
-        std::mutex queue_mutex_; ///< Mutex for queue operations.
-        std::condition_variable queue_condition_; ///< Condition variable for queue notifications.
-        bool stop_flag_; ///< Flag to stop the event loop.
-        std::thread event_loop_thread_; ///< Thread running the event loop.
+        template <typename Topic, typename Fn, typename... Ts>
+        int subscribe_to(Fn&& handler, std::tuple<Ts...>) {
+            static_assert(std::is_invocable_v<std::decay_t<Fn>&, Ts&...> || std::is_invocable_v<std::decay_t<Fn>&, Ts&&...>,
+                          "microbus: the handler does not accept the arguments of the topic");
+            auto& slot = std::get<index_of<Topic>()>(slots_);
+            using list_type = detail::subscriber_list<Ts...>;
+            std::unique_lock lock(slot.mutex_);
+            // Only the slot's writer mutates a published snapshot, and only past the prefix readers see.
+            auto* current = const_cast<list_type*>(slot.handlers_.load(std::memory_order_relaxed));
+            if (const auto* last = current ? current->last_live() : nullptr; last && !last->handler_.shareable()) {
+                throw std::logic_error("microbus: a handler owning the arguments must be the last subscriber of a static topic");
+            }
+            if constexpr (Topic::capacity > 0) {
+                if (current && current->live_count() >= Topic::capacity) {
+                    throw std::length_error("microbus: the static topic has no free subscriber slot");
+                }
+            }
+            int id = next_id_.fetch_add(1, std::memory_order_relaxed);
+#if MICROBUS_ENABLE_METRICS
+            typename list_type::entry subscriber{id, detail::inline_handler<Ts...>(std::forward<Fn>(handler)), std::make_shared<detail::latency_histogram>()};
+#else
+            typename list_type::entry subscriber{id, detail::inline_handler<Ts...>(std::forward<Fn>(handler))};
+#endif
+            if (current && !current->full()) {
+                current->append(std::move(subscriber));
+                return id;
+            }
+            auto next = current ? current->compacted(std::max<std::size_t>(Topic::capacity, 1)) : std::make_unique<list_type>();
+            next->append(std::move(subscriber));
+            publish(slot, next.release());
+            return id;
+        }
 
-        std::mutex wait_mutex_; ///< Mutex for wait operations.
-        std::condition_variable wait_condition_; ///< Condition variable for wait notifications.
+        template <typename Topic, typename... Ts, typename... Params>
+        void trigger_with(std::tuple<Ts...>, Params&&... params) {
+            static_assert(sizeof...(Params) == sizeof...(Ts) && (std::is_constructible_v<Ts, Params&&> && ...),
+                          "microbus: the arguments do not match the topic");
+            auto& slot = std::get<index_of<Topic>()>(slots_);
+            if (!slot.handlers_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            std::tuple<Ts...> tuple_args(std::forward<Params>(params)...);
+            std::apply([this](Ts&... unpacked) { deliver<Topic>(unpacked...); }, tuple_args);
+        }
 
         /**
-         * @brief Processes the event loop by handling events in the queue.
+         * @brief Calls the handlers of a topic.
+         * @tparam Topic The topic type.
+         * @tparam Ts Argument types of the topic.
+         * @param args The arguments, moved into the last handler.
          */
-        void process_event_loop() {
-            while (true) {
-                std::function<void()> event_task;
-
-                {
-                    std::unique_lock lock(queue_mutex_);
-                    queue_condition_.wait(lock, [this] { return stop_flag_ || !async_event_queue_.empty(); });
-
-                    if (stop_flag_ && async_event_queue_.empty()) {
-                        break;
-                    }
-
-                    event_task = std::move(async_event_queue_.front());
-                    async_event_queue_.pop();
-                }
-
-                event_task();
-
-                // Notify that an event has been processed and possibly that the queue is empty
-                {
-                    std::unique_lock lock(wait_mutex_);
-                    wait_condition_.notify_all();
-                }
+        template <typename Topic, typename... Ts>
+        void deliver(Ts&... args) {
+            detail::epoch_guard guard;
+            if (auto* handlers = std::get<index_of<Topic>()>(slots_).handlers_.load()) {
+                handlers->invoke(nullptr, args...);
             }
         }
+
+        /**
+         * @brief Publishes a new snapshot of a slot and retires the previous one, the caller must hold its mutex.
+         * @tparam Slot The slot type.
+         * @param slot The slot.
+         * @param handlers The new snapshot, may be nullptr.
+         */
+        template <typename Slot>
+        static void publish(Slot& slot, const typename Slot::list_type* handlers) {
+            auto* previous = slot.handlers_.exchange(handlers);
+            detail::epoch_domain::instance().retire(previous);
+        }
+
+        std::tuple<typename detail::static_slot_of<Topics>::type...> slots_; ///< Subscribers of every topic, in declaration order.
+        std::atomic<int> next_id_{0}; ///< The next subscription ID.
     };
 
     /**
@@ -298,6 +6411,16 @@ namespace microbus {
                 : bus_(bus ? bus : std::make_shared<microbus::event_bus>()) {
         }
 
+        /**
+         * @brief Constructs a shared_context whose event loop uses the given options.
+         *
+         * @param options Options of the event loop, including worker placement and naming.
+         * @param bus Shared pointer to an event bus. If nullptr, a new event bus is created.
+         */
+        explicit shared_context(const event_loop_options& options, const std::shared_ptr<microbus::event_bus>& bus = nullptr)
+                : bus_(bus ? bus : std::make_shared<microbus::event_bus>()), loop_(options) {
+        }
+
         /**
          * @brief Gets the current event bus.
          *
@@ -320,6 +6443,66 @@ namespace microbus {
             return bus_->subscribe(event_name, handler);
         }
 
+        /**
+         * @brief Interns a topic on the bus and returns a handle to it.
+         *
+         * @tparam Args Types of arguments of the topic.
+         * @param event_name Name of the event.
+         * @return A handle that can be used instead of the event name.
+         */
+        template <typename... Args>
+        topic_handle<Args...> topic(const std::string& event_name) {
+            return bus_->topic<Args...>(event_name);
+        }
+
+        /**
+         * @brief Subscribes to an interned topic with a specified handler.
+         *
+         * @tparam Args Types of arguments of the topic.
+         * @param topic The topic handle.
+         * @param handler Function to handle the event.
+         * @return Subscription ID.
+         */
+        template <typename... Args, typename Fn>
+        int subscribe(const topic_handle<Args...>& topic, Fn&& handler) {
+            return bus_->subscribe(topic, std::forward<Fn>(handler));
+        }
+
+        /**
+         * @brief Subscribes to an interned topic with a handler that runs on the context's event loop.
+         *
+         * @tparam Args Types of arguments of the topic.
+         * @param topic The topic handle.
+         * @param handler Function to handle the event on a loop worker.
+         * @return Subscription ID.
+         */
+        template <typename... Args, typename Fn>
+        int subscribe_async(const topic_handle<Args...>& topic, Fn&& handler) {
+            return bus_->subscribe(topic, std::forward<Fn>(handler), loop_);
+        }
+
+        /**
+         * @brief Subscribes to every topic whose name matches a pattern.
+         *
+         * @tparam Args Types of arguments of the matching topics.
+         * @param pattern The pattern, `*` matches one segment and `#` any number.
+         * @param handler Function to handle the events.
+         * @return Subscription ID.
+         */
+        template <typename... Args, typename Fn>
+        int subscribe_pattern(const std::string& pattern, Fn&& handler) {
+            return bus_->subscribe_pattern<Args...>(pattern, std::forward<Fn>(handler));
+        }
+
+        /**
+         * @brief Unsubscribes a pattern subscription.
+         * @param pattern The pattern.
+         * @param id The subscription ID.
+         */
+        void unsubscribe_pattern(const std::string& pattern, int id) {
+            bus_->unsubscribe_pattern(pattern, id);
+        }
+
         /**
          * @brief Unsubscribes from an event.
          * @param event_name The name of the event.
@@ -329,17 +6512,183 @@ namespace microbus {
             bus_->unsubscribe(event_name, id);
         }
 
+        /**
+         * @brief Unsubscribes from an interned topic.
+         * @param topic The topic handle.
+         * @param id The subscription ID.
+         */
+        template <typename... Args>
+        void unsubscribe(const topic_handle<Args...>& topic, int id) {
+            bus_->unsubscribe(topic, id);
+        }
+
         /**
          * @brief Enqueues an event to be processed by the event loop.
          *
          * @tparam Args Types of arguments that the event handler takes.
          * @param event_name Name of the event.
          * @param params Parameters to pass to the event handler.
+         * @return Whether the event was queued.
+         */
+        template <typename... Args>
+        enqueue_result enqueue_event(const std::string& event_name, Args&&... params)
+        {
+            return loop_.enqueue_event(bus_, event_name, std::forward<Args>(params)...);
+        }
+
+        /**
+         * @brief Enqueues an interned topic to be processed by the event loop.
+         *
+         * @tparam Args Types of arguments of the topic.
+         * @param topic The topic handle.
+         * @param params Parameters to pass to the event handler.
+         * @return Whether the event was queued.
+         */
+        template <typename... Args, typename... Params>
+        enqueue_result enqueue_event(const topic_handle<Args...>& topic, Params&&... params)
+        {
+            return loop_.enqueue_event(bus_, topic, std::forward<Params>(params)...);
+        }
+
+        /**
+         * @brief Enqueues an event in a priority lane, optionally with a deadline.
+         *
+         * @tparam Topic Type of the topic, an event name or a topic handle.
+         * @param options The lane and deadline of the event.
+         * @param topic The name of the event or the topic handle.
+         * @param params Parameters to pass to the event handler.
+         * @return Whether the event was queued.
+         */
+        template <typename Topic, typename... Params>
+        enqueue_result enqueue_event(const enqueue_options& options, const Topic& topic, Params&&... params)
+        {
+            return loop_.enqueue_event(bus_, options, topic, std::forward<Params>(params)...);
+        }
+
+        /**
+         * @brief Enqueues an event of an interned topic whose argument is constructed in the queue slot.
+         *
+         * @tparam T Argument type of the topic.
+         * @param topic The topic handle.
+         * @param ctor_args Arguments to construct the `T` from.
+         * @return Whether the event was queued.
+         */
+        template <typename T, typename... CtorArgs>
+        enqueue_result emplace_event(const topic_handle<T>& topic, CtorArgs&&... ctor_args)
+        {
+            return loop_.emplace_event(bus_, topic, std::forward<CtorArgs>(ctor_args)...);
+        }
+
+        /**
+         * @brief Enqueues one event of an interned topic per element of a range.
+         *
+         * @tparam Args Types of arguments of the topic.
+         * @tparam Range Type of the range.
+         * @param topic The topic handle.
+         * @param range The event arguments, tuple-like elements for topics with several arguments.
+         * @return Number of events queued.
+         */
+        template <typename... Args, typename Range>
+        std::size_t enqueue_batch(const topic_handle<Args...>& topic, Range&& range)
+        {
+            return loop_.enqueue_batch(bus_, topic, std::forward<Range>(range));
+        }
+
+#if MICROBUS_HAS_COROUTINES
+        /**
+         * @brief Moves the awaiting coroutine onto a worker of the event loop.
+         *
+         * @return The awaitable.
+         */
+        [[nodiscard]] auto schedule()
+        {
+            return loop_.schedule();
+        }
+
+        /**
+         * @brief Gets an awaitable for the next event of an interned topic, resumed on a worker of the event loop.
+         *
+         * @tparam Args Types of arguments of the topic.
+         * @param topic The topic handle.
+         * @return The awaitable.
          */
         template <typename... Args>
-        void enqueue_event(const std::string& event_name, Args&&... params)
+        [[nodiscard]] next_event<Args...> next(const topic_handle<Args...>& topic)
+        {
+            return loop_.next(bus_, topic);
+        }
+#endif
+
+        /**
+         * @brief Enqueues the newest value of an interned topic, replacing a pending one.
+         *
+         * @tparam Args Types of arguments of the topic.
+         * @param topic The topic handle.
+         * @param params Parameters to pass to the event handler.
+         * @return `conflated` if a pending value was replaced, otherwise whether the event was queued.
+         */
+        template <typename... Args, typename... Params>
+        enqueue_result enqueue_latest(const topic_handle<Args...>& topic, Params&&... params)
+        {
+            return loop_.enqueue_latest(bus_, topic, std::forward<Params>(params)...);
+        }
+
+        /**
+         * @brief Enqueues the newest value of an interned topic for a key, replacing a pending one.
+         *
+         * @tparam Args Types of arguments of the topic.
+         * @param key The conflation key.
+         * @param topic The topic handle.
+         * @param params Parameters to pass to the event handler.
+         * @return `conflated` if a pending value was replaced, otherwise whether the event was queued.
+         */
+        template <typename... Args, typename... Params>
+        enqueue_result enqueue_latest(std::uint64_t key, const topic_handle<Args...>& topic, Params&&... params)
+        {
+            return loop_.enqueue_latest(bus_, key, topic, std::forward<Params>(params)...);
+        }
+
+        /**
+         * @brief Enqueues an event once a delay has elapsed.
+         *
+         * @tparam Rep Tick type of the delay.
+         * @tparam Period Tick period of the delay.
+         * @tparam Topic Type of the topic, an event name or a topic handle.
+         * @param delay Time to wait before the event is queued.
+         * @param topic The name of the event or the topic handle.
+         * @param params Parameters to pass to the event handler.
+         * @return A handle to cancel the timer.
+         */
+        template <typename Rep, typename Period, typename Topic, typename... Params>
+        timer_handle enqueue_after(const std::chrono::duration<Rep, Period>& delay, const Topic& topic, Params&&... params)
         {
-            loop_.enqueue_event(bus_, event_name, std::forward<Args>(params)...);
+            return loop_.enqueue_after(bus_, delay, topic, std::forward<Params>(params)...);
+        }
+
+        /**
+         * @brief Enqueues an event every time a period elapses.
+         *
+         * @tparam Rep Tick type of the period.
+         * @tparam Period Tick period of the period.
+         * @tparam Topic Type of the topic, an event name or a topic handle.
+         * @param period Time between events.
+         * @param topic The name of the event or the topic handle.
+         * @param params Parameters to pass to the event handler.
+         * @return A handle to cancel the timer.
+         */
+        template <typename Rep, typename Period, typename Topic, typename... Params>
+        timer_handle schedule_every(const std::chrono::duration<Rep, Period>& period, const Topic& topic, Params&&... params)
+        {
+            return loop_.schedule_every(bus_, period, topic, std::forward<Params>(params)...);
+        }
+
+        /**
+         * @brief Cancels a delayed or periodic event.
+         * @param timer The timer handle.
+         * @return False if the timer already fired or was cancelled.
+         */
+        bool cancel_timer(const timer_handle& timer) {
+            return loop_.cancel_timer(timer);
         }
 
         /**
@@ -349,6 +6698,19 @@ namespace microbus {
             loop_.wait_until_finished();
         }
 
+        /**
+         * @brief Waits until the event loop has finished processing all events, or the timeout expires.
+         *
+         * @tparam Rep Tick type of the timeout.
+         * @tparam Period Tick period of the timeout.
+         * @param timeout Maximum time to wait.
+         * @return True if the loop became idle, false on timeout.
+         */
+        template <typename Rep, typename Period>
+        bool wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+            return loop_.wait_for(timeout);
+        }
+
         /**
          * @brief Stops the internal event loop.
          */
@@ -0,0 +1,565 @@
+#ifndef MICROBUS_MICROBUS_JOURNAL_HPP
+#define MICROBUS_MICROBUS_JOURNAL_HPP
+
+/*
+MIT License
+
+Copyright (c) 2024 Igal Alkon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "microbus_journal.hpp requires POSIX memory-mapped files"
+#endif
+
+#include "microbus_wire.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace microbus {
+
+    /**
+     * @brief When a journal flushes its mapping to disk.
+     */
+    enum class journal_sync {
+        none, ///< Leave write-back to the operating system, records survive a process crash but not a host crash.
+        interval, ///< Flush at most once per `sync_interval` while records are being written.
+        batch ///< Flush after every batch the flusher thread writes.
+    };
+
+    /**
+     * @brief Buffering and durability of a journal.
+     */
+    struct journal_options {
+        std::size_t segment_size = 16 << 20; ///< Bytes the file is extended by when its mapping is full.
+        std::size_t max_pending_bytes = 1 << 20; ///< Encoded bytes buffered before the overflow policy applies.
+        overflow_policy on_overflow = overflow_policy::block; ///< Behavior of a writer with a full buffer, `drop_oldest` is not supported.
+        journal_sync sync = journal_sync::none; ///< When written records are flushed to disk.
+        std::chrono::milliseconds sync_interval = std::chrono::milliseconds(100); ///< Flush period of `journal_sync::interval`.
+    };
+
+    namespace detail {
+        inline constexpr std::uint64_t journal_magic = 0x6c6e72756f6a626dull; ///< "mbjournl" at the start of a journal file.
+        inline constexpr std::uint32_t journal_version = 1; ///< Layout version of the records.
+
+        /**
+         * @brief Header at the start of a journal file.
+         */
+        struct journal_header {
+            std::uint64_t magic_; ///< `journal_magic`.
+            std::uint32_t version_; ///< Layout version.
+            std::uint32_t reserved_; ///< Padding.
+        };
+
+        /**
+         * @brief Header of a record, followed by `size_` bytes.
+         *
+         * Fields are in host byte order. The file is extended with zeros, so a zero timestamp marks
+         * the end of the records a crashed writer left behind.
+         */
+        struct journal_record {
+            std::uint32_t channel_; ///< Topic ID on the recording bus, or `journal_declare`.
+            std::uint32_t size_; ///< Bytes following the header.
+            std::int64_t time_; ///< Nanoseconds since the epoch of the system clock.
+        };
+
+        /**
+         * @brief Channel of records that declare a topic: its recording ID followed by its name.
+         */
+        inline constexpr std::uint32_t journal_declare = UINT32_MAX;
+
+        /**
+         * @brief Finds the end of the complete records of a journal.
+         * @param data The journal, starting with its header.
+         * @param size Size of the journal.
+         * @return Offset just past the last complete record.
+         */
+        inline std::size_t journal_end(const std::byte* data, std::size_t size) {
+            std::size_t offset = sizeof(journal_header);
+            journal_record record;
+            while (size - offset >= sizeof(record)) {
+                std::memcpy(&record, data + offset, sizeof(record));
+                if (record.time_ == 0 || size - offset - sizeof(record) < record.size_) {
+                    break;
+                }
+                offset += sizeof(record) + record.size_;
+            }
+            return offset;
+        }
+
+        /**
+         * @brief Checks the header of a mapped journal.
+         * @param data The mapping.
+         * @param size Size of the mapping.
+         * @param path Path of the file, for the error message.
+         * @throws std::runtime_error If the file is not a journal of this version.
+         */
+        inline void check_journal(const std::byte* data, std::size_t size, const std::string& path) {
+            journal_header header{};
+            if (size >= sizeof(header)) {
+                std::memcpy(&header, data, sizeof(header));
+            }
+            if (header.magic_ != journal_magic || header.version_ != journal_version) {
+                throw std::runtime_error("microbus: '" + path + "' is not a journal");
+            }
+        }
+    }
+
+    /**
+     * @brief Records events of selected topics into an append-only, memory-mapped journal file.
+     *
+     * Publishers encode events with a timestamp into a buffer and return; a flusher thread swaps
+     * the buffer with its own and copies the whole batch into the mapping, extending the file by
+     * `segment_size` when it is full, and flushes it to disk as `sync` requests. Payloads are
+     * encoded with `wire_codec`. Opening an existing journal appends after its last complete
+     * record, and closing trims the file to the records.
+     */
+    class journal_writer {
+    public:
+        /**
+         * @brief Opens or creates a journal and starts the flusher thread.
+         * @param path Path of the journal file.
+         * @param options Buffering and durability.
+         * @throws std::invalid_argument If the overflow policy is `drop_oldest`.
+         * @throws std::system_error If the file cannot be opened or mapped.
+         * @throws std::runtime_error If an existing file is not a journal.
+         */
+        explicit journal_writer(const std::string& path, const journal_options& options = {})
+                : options_(options), pending_(options.max_pending_bytes, options.on_overflow) {
+            if (options_.on_overflow == overflow_policy::drop_oldest) {
+                throw std::invalid_argument("microbus: journals cannot drop the oldest event");
+            }
+            options_.segment_size = std::max<std::size_t>(options_.segment_size, 4096);
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (fd_ < 0) {
+                throw std::system_error(errno, std::generic_category(), "microbus: open " + path);
+            }
+            try {
+                struct stat info{};
+                checked(::fstat(fd_, &info), "fstat");
+                auto size = static_cast<std::size_t>(info.st_size);
+                if (size == 0) {
+                    map(options_.segment_size);
+                    detail::journal_header header{detail::journal_magic, detail::journal_version, 0};
+                    std::memcpy(base_, &header, sizeof(header));
+                    end_ = sizeof(header);
+                } else {
+                    map(size);
+                    detail::check_journal(base_, size, path);
+                    end_ = detail::journal_end(base_, size);
+                }
+            } catch (...) {
+                if (base_) {
+                    ::munmap(base_, mapped_);
+                }
+                ::close(fd_);
+                throw;
+            }
+            synced_ = end_;
+            flusher_ = std::thread([this] { flush_loop(); });
+        }
+
+        journal_writer(const journal_writer&) = delete;
+        journal_writer& operator=(const journal_writer&) = delete;
+
+        /**
+         * @brief Removes the recordings, writes what is buffered and closes the file.
+         */
+        ~journal_writer() {
+            for (auto& detach : recordings_) {
+                detach();
+            }
+            pending_.stop();
+            flusher_.join();
+            ::munmap(base_, mapped_);
+            if (::ftruncate(fd_, static_cast<off_t>(end_)) == 0 && options_.sync != journal_sync::none) {
+                ::fsync(fd_);
+            }
+            ::close(fd_);
+        }
+
+        /**
+         * @brief Records every event of a topic.
+         *
+         * Events are recorded when the bus delivers them, so events an `event_loop` enqueues for the
+         * topic are recorded, and timestamped, when the loop dispatches them.
+         *
+         * @tparam Args Argument types of the topic.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @return The subscription ID on the bus, the subscription is removed with the writer.
+         */
+        template <typename... Args>
+        int record(const std::shared_ptr<event_bus>& bus, const topic_handle<Args...>& topic) {
+            auto id = bus->subscribe(topic, [this, topic](const Args&... args) { write(topic, args...); });
+            recordings_.emplace_back([bus, topic, id] { bus->unsubscribe(topic, id); });
+            return id;
+        }
+
+        /**
+         * @brief Buffers an event of a topic for the journal.
+         * @tparam Args Argument types of the topic.
+         * @param topic The topic handle, declared in the journal on first use.
+         * @param args The arguments.
+         * @return Whether the event was buffered, dropped or rejected; rejected once writing the file failed.
+         */
+        template <typename... Args>
+        enqueue_result write(const topic_handle<Args...>& topic, const Args&... args) {
+            auto size = detail::wire_encoded_size<Args...>(args...);
+            auto channel = static_cast<std::uint32_t>(topic.id());
+            auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            std::unique_lock lock(pending_.mutex_);
+            pending_.declare(channel, topic.name(), {detail::journal_declare, 0, now});
+            if (auto result = pending_.reserve(lock, sizeof(detail::journal_record) + size)) {
+                return *result;
+            }
+            auto* out = pending_.append({channel, 0, now}, size);
+            (detail::wire_encode_one<Args>(args, out), ...);
+            lock.unlock();
+            pending_.ready_.notify_one();
+            return enqueue_result::queued;
+        }
+
+        /**
+         * @brief Blocks until everything buffered is in the file, and flushed to disk unless the policy is `none`.
+         * @return False if writing the file failed.
+         */
+        bool flush() {
+            std::unique_lock lock(pending_.mutex_);
+            flush_requested_ = true;
+            pending_.ready_.notify_one();
+            pending_.space_.wait(lock, [this] { return pending_.failed_ || (pending_.bytes_.empty() && !pending_.writing_ && !flush_requested_); });
+            return !pending_.failed_;
+        }
+
+        /**
+         * @brief Gets the number of events dropped because the buffer was full.
+         * @return The dropped count under `overflow_policy::drop_newest`.
+         */
+        [[nodiscard]] std::size_t dropped() const {
+            return pending_.dropped_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Checks whether writing the file failed.
+         * @return True once the journal is broken, for example when the disk is full.
+         */
+        [[nodiscard]] bool failed() const {
+            std::unique_lock lock(pending_.mutex_);
+            return pending_.failed_;
+        }
+
+    private:
+        /**
+         * @brief Throws the current `errno` if a system call failed.
+         * @param result Result of the call.
+         * @param what Name of the call.
+         * @throws std::system_error If the result is negative.
+         */
+        static void checked(int result, const char* what) {
+            if (result < 0) {
+                throw std::system_error(errno, std::generic_category(), std::string("microbus: ") + what);
+            }
+        }
+
+        /**
+         * @brief Extends the file if needed and maps it, replacing the previous mapping.
+         * @param size Size of the new mapping.
+         * @throws std::system_error If the file cannot be extended or mapped.
+         */
+        void map(std::size_t size) {
+            struct stat info{};
+            checked(::fstat(fd_, &info), "fstat");
+            if (static_cast<std::size_t>(info.st_size) < size) {
+                checked(::ftruncate(fd_, static_cast<off_t>(size)), "ftruncate");
+            }
+            auto* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (base == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "microbus: mmap");
+            }
+            if (base_) {
+                ::munmap(base_, mapped_);
+            }
+            base_ = static_cast<std::byte*>(base);
+            mapped_ = size;
+        }
+
+        /**
+         * @brief Copies a batch to the end of the records, extending the file when the mapping is full.
+         * @param batch The encoded records.
+         * @return False if the file cannot be extended.
+         */
+        bool store(const std::vector<std::byte>& batch) {
+            if (end_ + batch.size() > mapped_) {
+                auto segments = (end_ + batch.size() + options_.segment_size - 1) / options_.segment_size;
+                try {
+                    map(std::max(segments * options_.segment_size, mapped_ + options_.segment_size));
+                } catch (const std::system_error&) {
+                    return false;
+                }
+            }
+            std::memcpy(base_ + end_, batch.data(), batch.size());
+            end_ += batch.size();
+            return true;
+        }
+
+        /**
+         * @brief Flushes the records written since the last flush to disk.
+         * @return False if the flush failed.
+         */
+        bool sync() {
+            static const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            auto from = synced_ / page * page;
+            synced_ = end_;
+            return ::msync(base_ + from, end_ - from, MS_SYNC) == 0;
+        }
+
+        /**
+         * @brief Writes buffered batches until the writer stops or the file fails.
+         */
+        void flush_loop() {
+            std::vector<std::byte> batch;
+            auto last_sync = std::chrono::steady_clock::now();
+            std::unique_lock lock(pending_.mutex_);
+            while (true) {
+                auto wake = [this] { return pending_.stopping_ || flush_requested_ || !pending_.bytes_.empty(); };
+                if (options_.sync == journal_sync::interval && synced_ != end_) {
+                    pending_.ready_.wait_until(lock, last_sync + options_.sync_interval, wake);
+                } else {
+                    pending_.ready_.wait(lock, wake);
+                }
+                bool stop = pending_.stopping_;
+                bool requested = flush_requested_;
+                pending_.take(lock, batch);
+                bool ok = batch.empty() || store(batch);
+                batch.clear();
+                auto now = std::chrono::steady_clock::now();
+                bool due = options_.sync == journal_sync::batch ||
+                           (options_.sync == journal_sync::interval && (stop || requested || now >= last_sync + options_.sync_interval));
+                if (ok && due && synced_ != end_) {
+                    ok = sync();
+                    last_sync = now;
+                }
+                // Waiters see the cleared request, they cannot look before the lock is released by the wait.
+                pending_.written(lock, ok);
+                if (requested && pending_.bytes_.empty()) {
+                    flush_requested_ = false;
+                }
+                if ((stop && pending_.bytes_.empty()) || pending_.failed_) {
+                    return;
+                }
+            }
+        }
+
+        int fd_ = -1; ///< The journal file.
+        journal_options options_; ///< Buffering and durability.
+        std::byte* base_ = nullptr; ///< The mapping of the file.
+        std::size_t mapped_ = 0; ///< Size of the mapping.
+        std::size_t end_ = 0; ///< Offset past the last record, only used by the flusher thread once it runs.
+        std::size_t synced_ = 0; ///< Offset up to which records were flushed to disk, only used by the flusher thread.
+        detail::wire_buffer<detail::journal_record> pending_; ///< Encoded records not yet handed to the flusher thread, and the file state.
+        bool flush_requested_ = false; ///< Set by `flush` until the flusher thread wrote and synced everything, guarded by the buffer mutex.
+        std::vector<std::function<void()>> recordings_; ///< Removes the recording subscriptions.
+        std::thread flusher_; ///< The flusher thread.
+    };
+
+    /**
+     * @brief Streams the events of a journal back into a bus.
+     *
+     * The file is mapped read-only and records are decoded in place. Recorded topics are matched to
+     * local ones by name, so the replaying bus may intern them in any order.
+     */
+    class journal_replayer {
+    public:
+        /**
+         * @brief Maps a journal.
+         * @param path Path of the journal file.
+         * @param bus The bus events are delivered on.
+         * @param loop Loop that events are enqueued on instead of being triggered inline, may be nullptr.
+         * @throws std::system_error If the file cannot be opened or mapped.
+         * @throws std::runtime_error If the file is not a journal.
+         */
+        journal_replayer(const std::string& path, std::shared_ptr<event_bus> bus, event_loop* loop = nullptr)
+                : bus_(std::move(bus)), loop_(loop) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "microbus: open " + path);
+            }
+            struct stat info{};
+            if (::fstat(fd, &info) != 0) {
+                auto error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "microbus: fstat");
+            }
+            size_ = static_cast<std::size_t>(info.st_size);
+            if (size_ > 0) {
+                auto* base = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (base == MAP_FAILED) {
+                    auto error = errno;
+                    ::close(fd);
+                    throw std::system_error(error, std::generic_category(), "microbus: mmap");
+                }
+                base_ = static_cast<const std::byte*>(base);
+            }
+            ::close(fd);
+            try {
+                detail::check_journal(base_, size_, path);
+            } catch (...) {
+                if (base_) {
+                    ::munmap(const_cast<std::byte*>(base_), size_);
+                }
+                throw;
+            }
+        }
+
+        journal_replayer(const journal_replayer&) = delete;
+        journal_replayer& operator=(const journal_replayer&) = delete;
+
+        ~journal_replayer() {
+            ::munmap(const_cast<std::byte*>(base_), size_);
+        }
+
+        /**
+         * @brief Delivers the recorded topic of the same name to a local topic.
+         * @tparam Args Argument types of the topic, they must match the recorded ones.
+         * @param topic The topic handle.
+         */
+        template <typename... Args>
+        void route(const topic_handle<Args...>& topic) {
+            routes_[topic.name()] = [this, topic](const std::byte* data, std::size_t size) {
+                if (!detail::wire_deliver(bus_, loop_, topic, data, size)) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                }
+            };
+        }
+
+        /**
+         * @brief Delivers every routed event of the journal in recorded order.
+         * @param speed Pace relative to the recording, 2 replays twice as fast; 0 delivers without waiting.
+         * @return Number of events delivered.
+         * @throws std::runtime_error If a record is malformed.
+         */
+        std::size_t replay(double speed = 0.0) {
+            channels_.clear();
+            auto end = detail::journal_end(base_, size_);
+            std::size_t delivered = 0;
+            std::optional<std::int64_t> first;
+            auto start = std::chrono::steady_clock::now();
+            detail::journal_record record;
+            for (auto offset = sizeof(detail::journal_header); offset < end;) {
+                std::memcpy(&record, base_ + offset, sizeof(record));
+                auto* payload = base_ + offset + sizeof(record);
+                offset += sizeof(record) + record.size_;
+                if (record.channel_ == detail::journal_declare) {
+                    declare(payload, record.size_);
+                    continue;
+                }
+                if (record.channel_ >= channels_.size() || !channels_[record.channel_]) {
+                    unrouted_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                if (speed > 0) {
+                    if (!first) {
+                        first = record.time_;
+                    }
+                    auto elapsed = std::chrono::nanoseconds(static_cast<std::int64_t>(static_cast<double>(record.time_ - *first) / speed));
+                    std::this_thread::sleep_until(start + elapsed);
+                }
+                (*channels_[record.channel_])(payload, record.size_);
+                ++delivered;
+            }
+            return delivered;
+        }
+
+        /**
+         * @brief Gets the number of recorded events of topics without a local route.
+         * @return The unrouted count.
+         */
+        [[nodiscard]] std::size_t unrouted() const {
+            return unrouted_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the number of events the event loop did not accept.
+         * @return The dropped count.
+         */
+        [[nodiscard]] std::size_t dropped() const {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        using decoder = std::function<void(const std::byte*, std::size_t)>;
+
+        /**
+         * @brief Maps a recorded topic ID to the local route of the same name.
+         * @param data The declaration: the ID followed by the name.
+         * @param size Size of the declaration.
+         * @throws std::runtime_error If the declaration is malformed.
+         */
+        void declare(const std::byte* data, std::size_t size) {
+            std::uint32_t channel;
+            if (size < sizeof(channel)) {
+                throw std::runtime_error("microbus: malformed topic declaration");
+            }
+            std::memcpy(&channel, data, sizeof(channel));
+            std::string name(reinterpret_cast<const char*>(data) + sizeof(channel), size - sizeof(channel));
+            if (channels_.size() <= channel) {
+                channels_.resize(channel + 1, nullptr);
+            }
+            auto it = routes_.find(name);
+            channels_[channel] = it != routes_.end() ? &it->second : nullptr;
+        }
+
+        std::shared_ptr<event_bus> bus_; ///< The bus that receives the events.
+        event_loop* loop_; ///< Loop events are enqueued on, may be nullptr.
+        const std::byte* base_ = nullptr; ///< The read-only mapping of the file.
+        std::size_t size_ = 0; ///< Size of the mapping.
+        std::unordered_map<std::string, decoder> routes_; ///< Local routes by topic name.
+        std::vector<const decoder*> channels_; ///< Routes by recorded topic ID.
+        std::atomic<std::size_t> unrouted_{0}; ///< Events of recorded topics without a route.
+        std::atomic<std::size_t> dropped_{0}; ///< Events the loop did not accept.
+    };
+
+    /**
+     * @brief Streams the events of selected topics from a journal into a bus.
+     * @tparam Topics Topic handle types.
+     * @param file Path of the journal file.
+     * @param bus The bus events are triggered on.
+     * @param speed Pace relative to the recording, 0 delivers without waiting.
+     * @param topics The topics to replay, matched to recorded ones by name.
+     * @return Number of events delivered.
+     * @throws std::system_error If the file cannot be opened or mapped.
+     * @throws std::runtime_error If the file is not a journal or a record is malformed.
+     */
+    template <typename... Topics>
+    std::size_t replay(const std::string& file, const std::shared_ptr<event_bus>& bus, double speed, const Topics&... topics) {
+        journal_replayer replayer(file, bus);
+        (replayer.route(topics), ...);
+        return replayer.replay(speed);
+    }
+}
+
+#endif //MICROBUS_MICROBUS_JOURNAL_HPP
@@ -0,0 +1,582 @@
+#ifndef MICROBUS_MICROBUS_NET_HPP
+#define MICROBUS_MICROBUS_NET_HPP
+
+/*
+MIT License
+
+Copyright (c) 2024 Igal Alkon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "microbus_net.hpp requires POSIX sockets"
+#endif
+
+#include "microbus_wire.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace microbus {
+
+    /**
+     * @brief Buffering and flow control of a network bridge.
+     */
+    struct net_options {
+        std::size_t max_pending_bytes = 1 << 20; ///< Encoded bytes a publisher buffers before its overflow policy applies.
+        overflow_policy on_overflow = overflow_policy::block; ///< Behavior of a publisher with a full buffer, `drop_oldest` is not supported.
+        std::size_t receive_buffer = 1 << 16; ///< Bytes a receiver reads per system call.
+        std::size_t max_frame_size = 1 << 24; ///< Largest frame payload sent or accepted, larger frames are rejected.
+    };
+
+    namespace detail {
+        /**
+         * @brief Header of a frame on the wire, followed by `size_` bytes.
+         *
+         * Fields are in host byte order, so both nodes must share it and the layout of
+         * trivially copyable payloads.
+         */
+        struct net_frame {
+            std::uint32_t channel_; ///< Topic ID on the sending bus, or `net_declare`.
+            std::uint32_t size_; ///< Bytes following the header.
+        };
+
+        /**
+         * @brief Channel of frames that declare a topic: its sending ID followed by its name.
+         */
+        inline constexpr std::uint32_t net_declare = UINT32_MAX;
+
+        /**
+         * @brief Throws the current `errno` if a socket call failed.
+         * @param result Result of the call.
+         * @param what Name of the call.
+         * @return The result.
+         * @throws std::system_error If the result is negative.
+         */
+        inline int net_checked(int result, const char* what) {
+            if (result < 0) {
+                throw std::system_error(errno, std::generic_category(), std::string("microbus: ") + what);
+            }
+            return result;
+        }
+
+        /**
+         * @brief Resolves an address and calls `bind` or `connect` with the first one that works.
+         * @param host Host name or address, nullptr for any local address.
+         * @param port The port.
+         * @param listen True to bind and listen, false to connect.
+         * @return The socket.
+         * @throws std::system_error If no address works.
+         */
+        inline int net_open(const char* host, std::uint16_t port, bool listen) {
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = listen ? AI_PASSIVE : 0;
+            addrinfo* found = nullptr;
+            auto service = std::to_string(port);
+            if (auto error = ::getaddrinfo(host, service.c_str(), &hints, &found)) {
+                throw std::runtime_error(std::string("microbus: getaddrinfo: ") + ::gai_strerror(error));
+            }
+            int last_error = 0;
+            for (auto* address = found; address; address = address->ai_next) {
+                int fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+                if (fd < 0) {
+                    last_error = errno;
+                    continue;
+                }
+                int on = 1;
+                bool ok = listen
+                        ? ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0 &&
+                          ::bind(fd, address->ai_addr, address->ai_addrlen) == 0 && ::listen(fd, 16) == 0
+                        : ::connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+                if (ok) {
+                    ::freeaddrinfo(found);
+                    if (!listen) {
+                        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                    }
+                    return fd;
+                }
+                last_error = errno;
+                ::close(fd);
+            }
+            ::freeaddrinfo(found);
+            throw std::system_error(last_error, std::generic_category(), listen ? "microbus: listen" : "microbus: connect");
+        }
+    }
+
+    /**
+     * @brief Connects a TCP socket with Nagle's algorithm disabled.
+     * @param host Host name or address.
+     * @param port The port.
+     * @return The connected socket.
+     * @throws std::system_error If the connection fails.
+     */
+    inline int tcp_connect(const std::string& host, std::uint16_t port) {
+        return detail::net_open(host.c_str(), port, false);
+    }
+
+    /**
+     * @brief Opens a listening TCP socket.
+     * @param port The port.
+     * @return The listening socket.
+     * @throws std::system_error If the port cannot be bound.
+     */
+    inline int tcp_listen(std::uint16_t port) {
+        return detail::net_open(nullptr, port, true);
+    }
+
+    /**
+     * @brief Accepts a connection on a listening socket, with Nagle's algorithm disabled.
+     * @param listener The listening socket.
+     * @return The connected socket.
+     * @throws std::system_error If accepting fails.
+     */
+    inline int tcp_accept(int listener) {
+        int fd = detail::net_checked(::accept(listener, nullptr, nullptr), "accept");
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        return fd;
+    }
+
+    /**
+     * @brief Sends events of local topics over a stream socket in batches.
+     *
+     * Producers encode events straight into a send buffer; a sender thread swaps it with its own
+     * and writes everything buffered with one system call, so a busy bridge sends many events per
+     * call. Each event is framed with the interned ID of its topic, which is declared once with
+     * the topic name. When the buffer holds `max_pending_bytes`, the overflow policy applies: with
+     * `block`, a bridge subscribed to topics an `event_loop` delivers stalls that loop, so its own
+     * overflow policy takes over.
+     */
+    class net_publisher {
+    public:
+        /**
+         * @brief Starts the sender thread on a connected socket.
+         * @param fd The socket, owned and closed by the publisher.
+         * @param options Buffering and flow control.
+         * @throws std::invalid_argument If the overflow policy is `drop_oldest`.
+         */
+        explicit net_publisher(int fd, const net_options& options = {})
+                : fd_(fd), options_(options), pending_(options.max_pending_bytes, options.on_overflow) {
+            if (options_.on_overflow == overflow_policy::drop_oldest) {
+                ::close(fd_);
+                throw std::invalid_argument("microbus: network publishers cannot drop the oldest event");
+            }
+            sender_ = std::thread([this] { send_loop(); });
+        }
+
+        net_publisher(const net_publisher&) = delete;
+        net_publisher& operator=(const net_publisher&) = delete;
+
+        /**
+         * @brief Removes the bridges, sends what is buffered and closes the socket.
+         */
+        ~net_publisher() {
+            for (auto& detach : bridges_) {
+                detach();
+            }
+            pending_.stop();
+            sender_.join();
+            ::close(fd_);
+        }
+
+        /**
+         * @brief Forwards every event of a local topic.
+         * @tparam Args Argument types of the topic.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @return The subscription ID on the bus, the subscription is removed with the publisher.
+         */
+        template <typename... Args>
+        int bridge(const std::shared_ptr<event_bus>& bus, const topic_handle<Args...>& topic) {
+            auto id = bus->subscribe(topic, [this, topic](const Args&... args) { publish(topic, args...); });
+            bridges_.emplace_back([bus, topic, id] { bus->unsubscribe(topic, id); });
+            return id;
+        }
+
+        /**
+         * @brief Buffers an event of a topic for sending.
+         * @tparam Args Argument types of the topic.
+         * @param topic The topic handle, declared to the peer on first use.
+         * @param args The arguments.
+         * @return Whether the event was buffered, dropped or rejected; rejected once the connection failed
+         * or if it encodes to more than `max_frame_size` bytes.
+         */
+        template <typename... Args>
+        enqueue_result publish(const topic_handle<Args...>& topic, const Args&... args) {
+            auto size = detail::wire_encoded_size<Args...>(args...);
+            if (size > options_.max_frame_size) {
+                return enqueue_result::rejected;
+            }
+            auto channel = static_cast<std::uint32_t>(topic.id());
+            std::unique_lock lock(pending_.mutex_);
+            pending_.declare(channel, topic.name(), {detail::net_declare, 0});
+            if (auto result = pending_.reserve(lock, sizeof(detail::net_frame) + size)) {
+                return *result;
+            }
+            auto* out = pending_.append({channel, 0}, size);
+            (detail::wire_encode_one<Args>(args, out), ...);
+            lock.unlock();
+            pending_.ready_.notify_one();
+            return enqueue_result::queued;
+        }
+
+        /**
+         * @brief Blocks until everything buffered has been written to the socket.
+         * @return False if the connection failed.
+         */
+        bool flush() {
+            std::unique_lock lock(pending_.mutex_);
+            pending_.space_.wait(lock, [this] { return pending_.failed_ || (pending_.bytes_.empty() && !pending_.writing_); });
+            return !pending_.failed_;
+        }
+
+        /**
+         * @brief Gets the number of events dropped because the send buffer was full.
+         * @return The dropped count under `overflow_policy::drop_newest`.
+         */
+        [[nodiscard]] std::size_t dropped() const {
+            return pending_.dropped_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Checks whether writing to the socket failed.
+         * @return True once the connection is broken.
+         */
+        [[nodiscard]] bool failed() const {
+            std::unique_lock lock(pending_.mutex_);
+            return pending_.failed_;
+        }
+
+    private:
+        /**
+         * @brief Writes buffered batches until the publisher stops or the connection fails.
+         */
+        void send_loop() {
+            std::vector<std::byte> batch;
+            std::unique_lock lock(pending_.mutex_);
+            while (true) {
+                pending_.ready_.wait(lock, [this] { return pending_.stopping_ || !pending_.bytes_.empty(); });
+                if (pending_.bytes_.empty() || pending_.failed_) {
+                    return;
+                }
+                pending_.take(lock, batch);
+                bool ok = write_all(batch.data(), batch.size());
+                batch.clear();
+                pending_.written(lock, ok);
+            }
+        }
+
+        /**
+         * @brief Writes a buffer completely.
+         * @param data The bytes.
+         * @param size Number of bytes.
+         * @return False if the connection failed.
+         */
+        bool write_all(const std::byte* data, std::size_t size) const {
+            while (size > 0) {
+                auto sent = ::send(fd_, data, size, MSG_NOSIGNAL);
+                if (sent < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data += sent;
+                size -= static_cast<std::size_t>(sent);
+            }
+            return true;
+        }
+
+        int fd_; ///< The connected socket.
+        net_options options_; ///< Buffering and flow control.
+        detail::wire_buffer<detail::net_frame> pending_; ///< Encoded frames not yet handed to the sender thread, and the connection state.
+        std::vector<std::function<void()>> bridges_; ///< Removes the bridge subscriptions.
+        std::thread sender_; ///< The sender thread.
+    };
+
+    /**
+     * @brief Republishes events received over a stream socket on a local bus.
+     *
+     * Many frames are read per system call and decoded directly from the receive buffer, so
+     * trivially copyable payloads are delivered without allocating. Remote topics are matched
+     * to local ones by name. Events are triggered on the receiving thread, or enqueued on an
+     * `event_loop` whose overflow policy then paces the receiver and, through TCP flow control,
+     * the sending node.
+     */
+    class net_receiver {
+    public:
+        /**
+         * @brief Constructs a receiver on a connected socket.
+         * @param fd The socket, owned and closed by the receiver.
+         * @param bus The bus events are delivered on.
+         * @param loop Loop that events are enqueued on instead of being triggered inline, may be nullptr.
+         * @param options The receive buffer size and the largest accepted frame.
+         */
+        net_receiver(int fd, std::shared_ptr<event_bus> bus, event_loop* loop = nullptr, const net_options& options = {})
+                : fd_(fd), bus_(std::move(bus)), loop_(loop), max_frame_size_(options.max_frame_size),
+                  buffer_(std::max<std::size_t>(options.receive_buffer, 64)) {}
+
+        net_receiver(const net_receiver&) = delete;
+        net_receiver& operator=(const net_receiver&) = delete;
+
+        ~net_receiver() {
+            stop();
+            ::close(fd_);
+        }
+
+        /**
+         * @brief Delivers the remote topic of the same name to a local topic, call before `start`.
+         * @tparam Args Argument types of the topic, they must match the sender's.
+         * @param topic The topic handle.
+         */
+        template <typename... Args>
+        void route(const topic_handle<Args...>& topic) {
+            routes_[topic.name()].decode_ = [this, topic](const std::byte* data, std::size_t size) {
+                if (!detail::wire_deliver(bus_, loop_, topic, data, size)) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                }
+            };
+        }
+
+        /**
+         * @brief Reads once from the socket and delivers every complete event, blocking until data arrives.
+         *
+         * An exception fails the receiver: it is recorded, the socket is shut down and later calls
+         * return nothing.
+         * @return Number of events delivered, or nothing once the connection closed or failed.
+         * @throws std::system_error If reading fails.
+         * @throws std::runtime_error If a frame is malformed or larger than `max_frame_size`.
+         */
+        std::optional<std::size_t> poll() {
+            if (failed()) {
+                return std::nullopt;
+            }
+            try {
+                return receive();
+            } catch (...) {
+                fail(std::current_exception());
+                throw;
+            }
+        }
+
+        /**
+         * @brief Starts a thread that delivers events until the connection closes or fails, or `stop` is called.
+         */
+        void start() {
+            thread_ = std::thread([this] {
+                try {
+                    while (!stop_flag_.load(std::memory_order_relaxed) && poll()) {
+                    }
+                } catch (...) {
+                    // Recorded by poll, see error().
+                }
+            });
+        }
+
+        /**
+         * @brief Shuts the socket down for reading and joins the receiver thread.
+         */
+        void stop() {
+            if (thread_.joinable()) {
+                stop_flag_.store(true);
+                ::shutdown(fd_, SHUT_RD);
+                thread_.join();
+            }
+        }
+
+        /**
+         * @brief Gets the number of events of remote topics without a local route.
+         * @return The unrouted count.
+         */
+        [[nodiscard]] std::size_t unrouted() const {
+            return unrouted_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the number of events the event loop did not accept.
+         * @return The dropped count.
+         */
+        [[nodiscard]] std::size_t dropped() const {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Checks whether reading or delivering failed.
+         * @return True once the receiver stopped on an error.
+         */
+        [[nodiscard]] bool failed() const {
+            std::unique_lock lock(error_mutex_);
+            return error_ != nullptr;
+        }
+
+        /**
+         * @brief Gets the error that stopped the receiver.
+         * @return The exception thrown by `recv`, a malformed frame or a handler, or nullptr.
+         */
+        [[nodiscard]] std::exception_ptr error() const {
+            std::unique_lock lock(error_mutex_);
+            return error_;
+        }
+
+    private:
+        /**
+         * @brief A local route and the remote topic ID currently declared for its name.
+         */
+        struct route_entry {
+            std::function<void(const std::byte*, std::size_t)> decode_; ///< Decodes and delivers a payload.
+            std::uint32_t channel_ = detail::net_declare; ///< The remote topic ID, `net_declare` while undeclared.
+        };
+
+        /**
+         * @brief Reads once from the socket and delivers every complete event.
+         * @return Number of events delivered, or nothing once the peer closed the connection.
+         */
+        std::optional<std::size_t> receive() {
+            if (filled_ == buffer_.size()) {
+                buffer_.resize(buffer_.size() * 2);
+            }
+            auto received = ::recv(fd_, buffer_.data() + filled_, buffer_.size() - filled_, 0);
+            if (received < 0) {
+                if (errno == EINTR) {
+                    return 0;
+                }
+                throw std::system_error(errno, std::generic_category(), "microbus: recv");
+            }
+            if (received == 0) {
+                return std::nullopt;
+            }
+            filled_ += static_cast<std::size_t>(received);
+
+            std::size_t delivered = 0;
+            std::size_t offset = 0;
+            detail::net_frame frame;
+            while (filled_ - offset >= sizeof(frame)) {
+                std::memcpy(&frame, buffer_.data() + offset, sizeof(frame));
+                check(frame);
+                if (filled_ - offset - sizeof(frame) < frame.size_) {
+                    break;
+                }
+                auto* payload = buffer_.data() + offset + sizeof(frame);
+                offset += sizeof(frame) + frame.size_;
+                if (frame.channel_ == detail::net_declare) {
+                    declare(payload, frame.size_);
+                } else if (auto it = channels_.find(frame.channel_); it != channels_.end()) {
+                    it->second->decode_(payload, frame.size_);
+                    ++delivered;
+                } else {
+                    unrouted_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            // Keep the start of an incomplete frame for the next read.
+            std::memmove(buffer_.data(), buffer_.data() + offset, filled_ - offset);
+            filled_ -= offset;
+            if (filled_ >= sizeof(frame)) {
+                // Already checked against max_frame_size by the loop above.
+                std::memcpy(&frame, buffer_.data(), sizeof(frame));
+                if (sizeof(frame) + frame.size_ > buffer_.size()) {
+                    buffer_.resize(sizeof(frame) + frame.size_);
+                }
+            }
+            return delivered;
+        }
+
+        /**
+         * @brief Rejects a frame larger than the receiver accepts, before its buffer grows for it.
+         * @param frame The frame header.
+         * @throws std::runtime_error If the payload exceeds `max_frame_size`.
+         */
+        void check(const detail::net_frame& frame) const {
+            if (frame.size_ > max_frame_size_) {
+                throw std::runtime_error("microbus: frame exceeds max_frame_size");
+            }
+        }
+
+        /**
+         * @brief Records the error that stops the receiver and shuts the socket down, so the peer sees a closed connection.
+         * @param error The exception.
+         */
+        void fail(std::exception_ptr error) {
+            {
+                std::unique_lock lock(error_mutex_);
+                error_ = std::move(error);
+            }
+            ::shutdown(fd_, SHUT_RDWR);
+        }
+
+        /**
+         * @brief Maps a remote topic ID to the local route of the same name.
+         *
+         * Only routed IDs are kept and each route holds one, so the map is bounded by the routes
+         * whatever IDs the peer sends.
+         * @param data The declaration: the ID followed by the name.
+         * @param size Size of the declaration.
+         * @throws std::runtime_error If the declaration is malformed.
+         */
+        void declare(const std::byte* data, std::size_t size) {
+            std::uint32_t channel;
+            if (size < sizeof(channel)) {
+                throw std::runtime_error("microbus: malformed topic declaration");
+            }
+            std::memcpy(&channel, data, sizeof(channel));
+            if (channel == detail::net_declare) {
+                throw std::runtime_error("microbus: malformed topic declaration");
+            }
+            std::string name(reinterpret_cast<const char*>(data) + sizeof(channel), size - sizeof(channel));
+            if (auto it = channels_.find(channel); it != channels_.end()) {
+                it->second->channel_ = detail::net_declare;
+                channels_.erase(it);
+            }
+            auto it = routes_.find(name);
+            if (it == routes_.end()) {
+                return;
+            }
+            if (it->second.channel_ != detail::net_declare) {
+                channels_.erase(it->second.channel_);
+            }
+            it->second.channel_ = channel;
+            channels_[channel] = &it->second;
+        }
+
+        int fd_; ///< The connected socket.
+        std::shared_ptr<event_bus> bus_; ///< The bus that receives the events.
+        event_loop* loop_; ///< Loop events are enqueued on, may be nullptr.
+        std::size_t max_frame_size_; ///< Largest accepted frame payload.
+        std::vector<std::byte> buffer_; ///< Received bytes, starting at a frame boundary.
+        std::size_t filled_ = 0; ///< Bytes of `buffer_` in use.
+        std::unordered_map<std::string, route_entry> routes_; ///< Local routes by topic name.
+        std::unordered_map<std::uint32_t, route_entry*> channels_; ///< Routes by remote topic ID, only routed IDs.
+        std::atomic<std::size_t> unrouted_{0}; ///< Events of remote topics without a route.
+        std::atomic<std::size_t> dropped_{0}; ///< Events the loop did not accept.
+        mutable std::mutex error_mutex_; ///< Guards the error.
+        std::exception_ptr error_; ///< The error that stopped the receiver.
+        std::atomic<bool> stop_flag_{false}; ///< Stops the receiver thread.
+        std::thread thread_; ///< The receiver thread.
+    };
+}
+
+#endif //MICROBUS_MICROBUS_NET_HPP
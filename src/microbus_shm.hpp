@@ -0,0 +1,589 @@
+#ifndef MICROBUS_MICROBUS_SHM_HPP
+#define MICROBUS_MICROBUS_SHM_HPP
+
+/*
+MIT License
+
+Copyright (c) 2024 Igal Alkon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if !defined(__linux__)
+#error "microbus_shm.hpp requires Linux: POSIX shared memory and futexes"
+#endif
+
+#include "microbus_wire.hpp"
+
+#include <cerrno>
+#include <ctime>
+#include <system_error>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace microbus {
+
+    /**
+     * @brief Geometry and behavior of a shared-memory ring.
+     */
+    struct shm_options {
+        std::size_t capacity = 1024; ///< Number of event slots, rounded up to a power of two.
+        std::size_t slot_size = 256; ///< Maximum size of an encoded event in bytes.
+        overflow_policy on_overflow = overflow_policy::block; ///< Behavior of publishers when the ring is full, `drop_oldest` is not supported.
+        std::chrono::milliseconds open_timeout = std::chrono::seconds(1); ///< How long to wait for another process to finish creating the segment.
+    };
+
+    namespace detail {
+        inline constexpr std::uint64_t shm_magic = 0x7375626f7263696dull; ///< "microbus" once the segment is initialized.
+        inline constexpr std::uint32_t shm_version = 1; ///< Layout version of the segment.
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+                      "microbus: shared-memory rings need address-free atomics");
+
+        /**
+         * @brief Header at the start of a shared-memory segment.
+         */
+        struct shm_header {
+            std::atomic<std::uint64_t> magic_; ///< Set last by the creator, `shm_magic` once the segment can be used.
+            std::uint32_t version_; ///< Layout version.
+            std::uint32_t reserved_; ///< Padding.
+            std::uint64_t capacity_; ///< Number of slots, a power of two.
+            std::uint64_t slot_size_; ///< Payload bytes per slot.
+            std::uint64_t stride_; ///< Bytes between slots.
+            alignas(64) std::atomic<std::uint64_t> enqueue_pos_; ///< Next slot claimed by producers.
+            alignas(64) std::atomic<std::uint64_t> dequeue_pos_; ///< Next slot read by the consumer.
+            alignas(64) std::atomic<std::uint32_t> sleeping_; ///< Set while the consumer is parked on `wake_`.
+            std::atomic<std::uint32_t> wake_; ///< Futex word, bumped to wake the consumer.
+        };
+
+        /**
+         * @brief Header of a slot, followed by the encoded event.
+         */
+        struct shm_slot {
+            std::atomic<std::uint64_t> sequence_; ///< Publication state of the slot.
+            std::uint32_t channel_; ///< Channel of the event.
+            std::uint32_t size_; ///< Encoded size of the event.
+        };
+
+        /**
+         * @brief Calls the futex system call on a shared word.
+         * @param word The futex word.
+         * @param op `FUTEX_WAIT` or `FUTEX_WAKE`.
+         * @param value Expected value or number of waiters to wake.
+         * @param timeout Relative timeout of a wait, may be nullptr.
+         */
+        inline void futex(std::atomic<std::uint32_t>& word, int op, std::uint32_t value, const timespec* timeout = nullptr) {
+            ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), op, value, timeout, nullptr, 0);
+        }
+    }
+
+    /**
+     * @brief A multi-producer, single-consumer event ring in a POSIX shared-memory segment.
+     *
+     * Producers claim a slot with one CAS and copy the encoded event into it, the consumer reads
+     * it in place. Neither side makes a system call while the consumer is awake; an idle consumer
+     * parks on a futex in the segment and producers wake it. A producer that dies between claiming
+     * and publishing a slot stalls the ring.
+     */
+    class shm_ring {
+    public:
+        /**
+         * @brief Creates the segment, or attaches to it if another process created it.
+         * @param name Name of the segment, such as "/prices".
+         * @param options Geometry used when creating, checked when attaching.
+         * @throws std::system_error If the segment cannot be opened or mapped.
+         * @throws std::runtime_error If an existing segment has a different layout or is not initialized in time.
+         */
+        shm_ring(const std::string& name, const shm_options& options) {
+            std::uint64_t capacity = 2;
+            while (capacity < options.capacity) {
+                capacity <<= 1;
+            }
+            auto stride = (sizeof(detail::shm_slot) + options.slot_size + 63) / 64 * 64;
+            auto bytes = sizeof(detail::shm_header) + capacity * stride;
+
+            bool created = true;
+            fd_ = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd_ < 0 && errno == EEXIST) {
+                created = false;
+                fd_ = ::shm_open(name.c_str(), O_RDWR, 0600);
+            }
+            if (fd_ < 0) {
+                throw std::system_error(errno, std::generic_category(), "microbus: shm_open " + name);
+            }
+            try {
+                if (created) {
+                    if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+                        throw std::system_error(errno, std::generic_category(), "microbus: ftruncate " + name);
+                    }
+                } else {
+                    bytes = attached_size(name, options.open_timeout);
+                }
+                map(bytes);
+                if (created) {
+                    ::new (header_) detail::shm_header();
+                    header_->version_ = detail::shm_version;
+                    header_->capacity_ = capacity;
+                    header_->slot_size_ = options.slot_size;
+                    header_->stride_ = stride;
+                    for (std::uint64_t i = 0; i < capacity; ++i) {
+                        ::new (slot(i)) detail::shm_slot();
+                        slot(i)->sequence_.store(i, std::memory_order_relaxed);
+                    }
+                    header_->magic_.store(detail::shm_magic, std::memory_order_release);
+                } else {
+                    await_initialized(options.open_timeout);
+                    if (header_->version_ != detail::shm_version || header_->capacity_ != capacity ||
+                        header_->slot_size_ != options.slot_size ||
+                        bytes < sizeof(detail::shm_header) + header_->capacity_ * header_->stride_) {
+                        throw std::runtime_error("microbus: shared-memory segment " + name + " has a different layout");
+                    }
+                }
+            } catch (...) {
+                release();
+                throw;
+            }
+        }
+
+        shm_ring(const shm_ring&) = delete;
+        shm_ring& operator=(const shm_ring&) = delete;
+
+        ~shm_ring() {
+            release();
+        }
+
+        /**
+         * @brief Removes a segment name, mapped segments stay valid until they are closed.
+         * @param name Name of the segment.
+         */
+        static void remove(const std::string& name) {
+            ::shm_unlink(name.c_str());
+        }
+
+        /**
+         * @brief Gets the payload capacity of a slot.
+         * @return Bytes per event.
+         */
+        [[nodiscard]] std::size_t slot_size() const {
+            return header_->slot_size_;
+        }
+
+        /**
+         * @brief Claims a slot, encodes an event into it and publishes it.
+         * @tparam Encode Type of the encoder.
+         * @param channel Channel of the event.
+         * @param size Encoded size, at most `slot_size()`.
+         * @param encode Writes `size` bytes to the pointer it is given.
+         * @return False if the ring is full.
+         */
+        template <typename Encode>
+        bool try_push(std::uint32_t channel, std::size_t size, Encode&& encode) {
+            auto mask = header_->capacity_ - 1;
+            auto pos = header_->enqueue_pos_.load(std::memory_order_relaxed);
+            detail::shm_slot* target;
+            while (true) {
+                target = slot(pos & mask);
+                auto sequence = target->sequence_.load(std::memory_order_acquire);
+                auto diff = static_cast<std::int64_t>(sequence - pos);
+                if (diff == 0) {
+                    if (header_->enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = header_->enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            target->channel_ = channel;
+            target->size_ = static_cast<std::uint32_t>(size);
+            encode(payload(target));
+            // Sequentially consistent so that the check for a parked consumer cannot miss it.
+            target->sequence_.store(pos + 1);
+            if (header_->sleeping_.load()) {
+                wake();
+            }
+            return true;
+        }
+
+        /**
+         * @brief Reads the oldest event in place and frees its slot, only one thread may consume.
+         * @tparam Fn Type of the reader.
+         * @param fn Called with the channel, the encoded bytes and their size.
+         * @return False if the ring is empty.
+         */
+        template <typename Fn>
+        bool try_pop(Fn&& fn) {
+            auto pos = header_->dequeue_pos_.load(std::memory_order_relaxed);
+            auto* target = slot(pos & (header_->capacity_ - 1));
+            if (target->sequence_.load(std::memory_order_acquire) != pos + 1) {
+                return false;
+            }
+            // The slot is freed even if the reader throws.
+            struct free_on_exit {
+                shm_ring& ring_;
+                detail::shm_slot* slot_;
+                std::uint64_t pos_;
+                ~free_on_exit() {
+                    slot_->sequence_.store(pos_ + ring_.header_->capacity_, std::memory_order_release);
+                    ring_.header_->dequeue_pos_.store(pos_ + 1, std::memory_order_relaxed);
+                }
+            } release{*this, target, pos};
+            fn(target->channel_, static_cast<const std::byte*>(payload(target)), static_cast<std::size_t>(target->size_));
+            return true;
+        }
+
+        /**
+         * @brief Parks the consumer until an event is published, `wake` is called or the timeout expires.
+         * @param timeout Longest time to wait.
+         * @return True if an event is ready.
+         */
+        bool wait(std::chrono::nanoseconds timeout) {
+            auto seen = header_->wake_.load();
+            header_->sleeping_.store(1);
+            if (!ready()) {
+                timespec relative{static_cast<std::time_t>(timeout.count() / 1000000000), static_cast<long>(timeout.count() % 1000000000)};
+                detail::futex(header_->wake_, FUTEX_WAIT, seen, &relative);
+            }
+            header_->sleeping_.store(0);
+            return ready();
+        }
+
+        /**
+         * @brief Wakes a parked consumer.
+         */
+        void wake() {
+            header_->wake_.fetch_add(1);
+            detail::futex(header_->wake_, FUTEX_WAKE, 1);
+        }
+
+        /**
+         * @brief Checks whether an event is ready to be read.
+         * @return True if the oldest slot holds a published event.
+         */
+        [[nodiscard]] bool ready() const {
+            auto pos = header_->dequeue_pos_.load(std::memory_order_relaxed);
+            return slot(pos & (header_->capacity_ - 1))->sequence_.load() == pos + 1;
+        }
+
+    private:
+        /**
+         * @brief Waits until the creator has sized the segment.
+         * @param name Name of the segment.
+         * @param timeout Longest time to wait.
+         * @return Size of the segment.
+         * @throws std::runtime_error If the segment is not sized in time.
+         */
+        std::size_t attached_size(const std::string& name, std::chrono::milliseconds timeout) const {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            struct stat info{};
+            while (::fstat(fd_, &info) == 0 && static_cast<std::size_t>(info.st_size) < sizeof(detail::shm_header)) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    throw std::runtime_error("microbus: shared-memory segment " + name + " was not initialized");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return static_cast<std::size_t>(info.st_size);
+        }
+
+        /**
+         * @brief Waits until the creator has published the header.
+         * @param timeout Longest time to wait.
+         * @throws std::runtime_error If the header is not published in time.
+         */
+        void await_initialized(std::chrono::milliseconds timeout) const {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (header_->magic_.load(std::memory_order_acquire) != detail::shm_magic) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    throw std::runtime_error("microbus: shared-memory segment was not initialized");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        /**
+         * @brief Maps the segment.
+         * @param bytes Size of the segment.
+         * @throws std::system_error If the mapping fails.
+         */
+        void map(std::size_t bytes) {
+            auto* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (base == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "microbus: mmap");
+            }
+            header_ = static_cast<detail::shm_header*>(base);
+            bytes_ = bytes;
+        }
+
+        /**
+         * @brief Unmaps and closes the segment.
+         */
+        void release() {
+            if (header_) {
+                ::munmap(header_, bytes_);
+                header_ = nullptr;
+            }
+            if (fd_ >= 0) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+
+        detail::shm_slot* slot(std::uint64_t index) const {
+            auto* base = reinterpret_cast<unsigned char*>(header_) + sizeof(detail::shm_header);
+            return reinterpret_cast<detail::shm_slot*>(base + index * header_->stride_);
+        }
+
+        static std::byte* payload(detail::shm_slot* target) {
+            return reinterpret_cast<std::byte*>(target) + sizeof(detail::shm_slot);
+        }
+
+        int fd_ = -1; ///< Descriptor of the segment.
+        detail::shm_header* header_ = nullptr; ///< The mapped segment.
+        std::size_t bytes_ = 0; ///< Size of the mapping.
+    };
+
+    /**
+     * @brief Forwards events of local topics into a shared-memory ring.
+     *
+     * Bridged topics are subscribed on their bus, so events reach the ring from `event_bus::trigger`
+     * and from `event_loop::enqueue_event` alike. Each topic is given a channel number that the
+     * receiving process routes to its own topic.
+     */
+    class shm_publisher {
+    public:
+        /**
+         * @brief Creates or attaches to a shared-memory ring.
+         * @param name Name of the segment.
+         * @param options Geometry of the ring and the overflow behavior.
+         * @throws std::invalid_argument If the overflow policy is `drop_oldest`.
+         */
+        explicit shm_publisher(const std::string& name, const shm_options& options = {}) : ring_(name, options), options_(options) {
+            if (options_.on_overflow == overflow_policy::drop_oldest) {
+                throw std::invalid_argument("microbus: shared-memory publishers cannot drop the oldest event");
+            }
+        }
+
+        shm_publisher(const shm_publisher&) = delete;
+        shm_publisher& operator=(const shm_publisher&) = delete;
+
+        ~shm_publisher() {
+            for (auto& detach : bridges_) {
+                detach();
+            }
+        }
+
+        /**
+         * @brief Forwards every event of a local topic to a channel of the ring.
+         * @tparam Args Argument types of the topic.
+         * @param bus Shared pointer to the event bus that owns the topic.
+         * @param topic The topic handle.
+         * @param channel The channel number.
+         * @return The subscription ID on the bus, the subscription is removed with the publisher.
+         */
+        template <typename... Args>
+        int bridge(const std::shared_ptr<event_bus>& bus, const topic_handle<Args...>& topic, std::uint32_t channel) {
+            auto id = bus->subscribe(topic, [this, channel](const Args&... args) { publish(channel, args...); });
+            bridges_.emplace_back([bus, topic, id] { bus->unsubscribe(topic, id); });
+            return id;
+        }
+
+        /**
+         * @brief Encodes an event into a channel of the ring.
+         * @tparam Args Argument types of the event.
+         * @param channel The channel number.
+         * @param args The arguments.
+         * @return Whether the event was queued, dropped or rejected under the overflow policy.
+         * @throws std::length_error If the encoded event does not fit a slot.
+         */
+        template <typename... Args>
+        enqueue_result publish(std::uint32_t channel, const Args&... args) {
+            auto size = detail::wire_encoded_size<std::decay_t<Args>...>(args...);
+            if (size > ring_.slot_size()) {
+                throw std::length_error("microbus: event does not fit a shared-memory slot");
+            }
+            auto encode = [&](std::byte* out) { (detail::wire_encode_one<std::decay_t<Args>>(args, out), ...); };
+            while (!ring_.try_push(channel, size, encode)) {
+                switch (options_.on_overflow) {
+                    case overflow_policy::drop_newest:
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                        return enqueue_result::dropped;
+                    case overflow_policy::fail:
+                        return enqueue_result::rejected;
+                    default:
+                        detail::spin_pause();
+                        std::this_thread::yield();
+                }
+            }
+            return enqueue_result::queued;
+        }
+
+        /**
+         * @brief Gets the number of events dropped because the ring was full.
+         * @return The dropped count under `overflow_policy::drop_newest`.
+         */
+        [[nodiscard]] std::size_t dropped() const {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        shm_ring ring_; ///< The shared-memory ring.
+        shm_options options_; ///< Ring geometry and overflow behavior.
+        std::atomic<std::size_t> dropped_{0}; ///< Events dropped on a full ring.
+        std::vector<std::function<void()>> bridges_; ///< Removes the bridge subscriptions.
+    };
+
+    /**
+     * @brief Drains a shared-memory ring into a local event bus.
+     *
+     * Each channel is routed to a local topic, its events are decoded and triggered on the bus,
+     * either by `poll` or by a receiver thread that spins briefly and then parks on the ring.
+     */
+    class shm_receiver {
+    public:
+        /**
+         * @brief Creates or attaches to a shared-memory ring.
+         * @param name Name of the segment.
+         * @param bus The bus events are triggered on.
+         * @param options Geometry of the ring.
+         */
+        shm_receiver(const std::string& name, std::shared_ptr<event_bus> bus, const shm_options& options = {})
+                : ring_(name, options), bus_(std::move(bus)) {}
+
+        shm_receiver(const shm_receiver&) = delete;
+        shm_receiver& operator=(const shm_receiver&) = delete;
+
+        ~shm_receiver() {
+            stop();
+        }
+
+        /**
+         * @brief Triggers a local topic for the events of a channel, call before `start`.
+         * @tparam Args Argument types of the topic, they must match the publisher's.
+         * @param channel The channel number.
+         * @param topic The topic handle.
+         */
+        template <typename... Args>
+        void route(std::uint32_t channel, const topic_handle<Args...>& topic) {
+            if (routes_.size() <= channel) {
+                routes_.resize(channel + 1);
+            }
+            routes_[channel] = [this, topic](const std::byte* data, std::size_t size) {
+                detail::wire_deliver(bus_, nullptr, topic, data, size);
+            };
+        }
+
+        /**
+         * @brief Triggers the events that are ready on the calling thread.
+         *
+         * An event whose decoding or handlers throw is removed from the ring before the exception
+         * propagates, so the next call continues with the following event.
+         * @param max Maximum number of events.
+         * @return Number of events read, including those of unrouted channels.
+         * @throws std::runtime_error If an event does not decode as the arguments of its route.
+         */
+        std::size_t poll(std::size_t max = SIZE_MAX) {
+            std::size_t count = 0;
+            while (count < max && ring_.try_pop([this](std::uint32_t channel, const std::byte* data, std::size_t size) {
+                if (channel < routes_.size() && routes_[channel]) {
+                    routes_[channel](data, size);
+                } else {
+                    unrouted_.fetch_add(1, std::memory_order_relaxed);
+                }
+            })) {
+                ++count;
+            }
+            return count;
+        }
+
+        /**
+         * @brief Starts a thread that triggers events as they arrive.
+         *
+         * Events that fail to decode or whose handlers throw are counted by `failed` and the thread
+         * keeps draining.
+         * @param spin How many empty polls the thread makes before it parks.
+         */
+        void start(std::size_t spin = 4096) {
+            stop_flag_.store(false);
+            thread_ = std::thread([this, spin] {
+                std::size_t idle = 0;
+                while (!stop_flag_.load(std::memory_order_relaxed)) {
+                    std::size_t read;
+                    try {
+                        read = poll(64);
+                    } catch (...) {
+                        failed_.fetch_add(1, std::memory_order_relaxed);
+                        read = 1;
+                    }
+                    if (read) {
+                        idle = 0;
+                    } else if (++idle < spin) {
+                        detail::spin_pause();
+                    } else {
+                        ring_.wait(std::chrono::milliseconds(100));
+                        idle = 0;
+                    }
+                }
+            });
+        }
+
+        /**
+         * @brief Stops and joins the receiver thread, events left in the ring stay there.
+         */
+        void stop() {
+            if (thread_.joinable()) {
+                stop_flag_.store(true);
+                ring_.wake();
+                thread_.join();
+            }
+        }
+
+        /**
+         * @brief Gets the number of events read from channels without a route.
+         * @return The unrouted count.
+         */
+        [[nodiscard]] std::size_t unrouted() const {
+            return unrouted_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the number of events the receiver thread could not deliver.
+         * @return The count of events that failed to decode or whose handlers threw.
+         */
+        [[nodiscard]] std::size_t failed() const {
+            return failed_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        shm_ring ring_; ///< The shared-memory ring.
+        std::shared_ptr<event_bus> bus_; ///< The bus that receives the events.
+        std::vector<std::function<void(const std::byte*, std::size_t)>> routes_; ///< Decoders by channel.
+        std::atomic<std::size_t> unrouted_{0}; ///< Events read from channels without a route.
+        std::atomic<std::size_t> failed_{0}; ///< Events the receiver thread could not deliver.
+        std::atomic<bool> stop_flag_{false}; ///< Stops the receiver thread.
+        std::thread thread_; ///< The receiver thread.
+    };
+}
+
+#endif //MICROBUS_MICROBUS_SHM_HPP
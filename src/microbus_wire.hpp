@@ -0,0 +1,291 @@
+#ifndef MICROBUS_MICROBUS_WIRE_HPP
+#define MICROBUS_MICROBUS_WIRE_HPP
+
+/*
+MIT License
+
+Copyright (c) 2024 Igal Alkon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "microbus.hpp"
+
+#include <cstring>
+
+namespace microbus {
+
+    /**
+     * @brief Encodes event arguments for the shared-memory and network transports, trivially copyable types are copied as is.
+     *
+     * Specialize it for other payload types with the same three static functions.
+     *
+     * @tparam T Decayed argument type.
+     */
+    template <typename T, typename = void>
+    struct wire_codec {
+        static_assert(std::is_trivially_copyable_v<T>, "microbus: specialize wire_codec for payloads that are not trivially copyable");
+
+        /**
+         * @brief Gets the encoded size of a value.
+         * @param value The value.
+         * @return Number of bytes.
+         */
+        static std::size_t size(const T&) { return sizeof(T); }
+
+        /**
+         * @brief Encodes a value.
+         * @param value The value.
+         * @param out Destination of `size(value)` bytes.
+         */
+        static void encode(const T& value, std::byte* out) { std::memcpy(out, &value, sizeof(T)); }
+
+        /**
+         * @brief Decodes a value.
+         * @param in The encoded bytes.
+         * @param size Number of encoded bytes.
+         * @return The value.
+         * @throws std::runtime_error If the size does not match the type.
+         */
+        static T decode(const std::byte* in, std::size_t size) {
+            if (size != sizeof(T)) {
+                throw std::runtime_error("microbus: encoded payload size mismatch");
+            }
+            alignas(T) unsigned char raw[sizeof(T)];
+            std::memcpy(raw, in, sizeof(T));
+            return *std::launder(reinterpret_cast<T*>(raw));
+        }
+    };
+
+    /**
+     * @brief Encodes strings as their characters.
+     */
+    template <>
+    struct wire_codec<std::string> {
+        static std::size_t size(const std::string& value) { return value.size(); }
+        static void encode(const std::string& value, std::byte* out) { std::memcpy(out, value.data(), value.size()); }
+        static std::string decode(const std::byte* in, std::size_t size) { return std::string(reinterpret_cast<const char*>(in), size); }
+    };
+
+    namespace detail {
+        /**
+         * @brief Gets the encoded size of event arguments, each prefixed by its length.
+         * @tparam Ts Decayed argument types.
+         * @param args The arguments.
+         * @return Number of bytes.
+         */
+        template <typename... Ts>
+        std::size_t wire_encoded_size(const Ts&... args) {
+            return ((sizeof(std::uint32_t) + wire_codec<Ts>::size(args)) + ... + 0);
+        }
+
+        /**
+         * @brief Encodes one argument with its length prefix.
+         * @tparam T Decayed argument type.
+         * @param value The argument.
+         * @param out Write position, advanced past the argument.
+         */
+        template <typename T>
+        void wire_encode_one(const T& value, std::byte*& out) {
+            auto size = static_cast<std::uint32_t>(wire_codec<T>::size(value));
+            std::memcpy(out, &size, sizeof(size));
+            wire_codec<T>::encode(value, out + sizeof(size));
+            out += sizeof(size) + size;
+        }
+
+        /**
+         * @brief Decodes one argument with its length prefix.
+         * @tparam T Decayed argument type.
+         * @param in Read position, advanced past the argument.
+         * @param end End of the encoded event.
+         * @return The argument.
+         * @throws std::runtime_error If the event is truncated.
+         */
+        template <typename T>
+        T wire_decode_one(const std::byte*& in, const std::byte* end) {
+            std::uint32_t size;
+            if (static_cast<std::size_t>(end - in) < sizeof(size)) {
+                throw std::runtime_error("microbus: truncated encoded event");
+            }
+            std::memcpy(&size, in, sizeof(size));
+            in += sizeof(size);
+            if (static_cast<std::size_t>(end - in) < size) {
+                throw std::runtime_error("microbus: truncated encoded event");
+            }
+            auto* data = in;
+            in += size;
+            return wire_codec<T>::decode(data, size);
+        }
+
+        /**
+         * @brief Decodes an event and triggers it on a bus, or enqueues it on a loop.
+         * @tparam Args Argument types of the topic.
+         * @param bus The bus that owns the topic.
+         * @param loop Loop the event is enqueued on instead of being triggered inline, may be nullptr.
+         * @param topic The topic handle.
+         * @param data The encoded arguments.
+         * @param size Number of encoded bytes.
+         * @return False if the loop did not accept the event.
+         * @throws std::runtime_error If the event does not decode as the arguments.
+         */
+        template <typename... Args>
+        bool wire_deliver(std::shared_ptr<event_bus>& bus, event_loop* loop, const topic_handle<Args...>& topic,
+                          const std::byte* data, std::size_t size) {
+            auto* end = data + size;
+            // Braced initialization decodes the arguments from left to right.
+            std::tuple<Args...> args{wire_decode_one<Args>(data, end)...};
+            return std::apply([&](Args&... unpacked) {
+                if (!loop) {
+                    bus->trigger(topic, std::move(unpacked)...);
+                    return true;
+                }
+                return loop->enqueue_event(bus, topic, std::move(unpacked)...) == enqueue_result::queued;
+            }, args);
+        }
+
+        /**
+         * @brief Encoded frames that producers buffer for a writer thread.
+         *
+         * Producers append frames under the mutex and apply the overflow policy once the buffer holds
+         * `max_bytes_`; the writer thread swaps the buffer with its own and writes the whole batch
+         * without the lock. Topics are declared by name on first use, in a frame of their own.
+         *
+         * @tparam Header Frame header with `channel_` and `size_` fields, followed by the payload.
+         */
+        template <typename Header>
+        struct wire_buffer {
+            /**
+             * @brief Constructs an empty buffer.
+             * @param max_bytes Bytes buffered before the overflow policy applies.
+             * @param policy Behavior of a producer with a full buffer, `drop_oldest` is not supported.
+             */
+            wire_buffer(std::size_t max_bytes, overflow_policy policy) : max_bytes_(max_bytes), policy_(policy) {}
+
+            /**
+             * @brief Buffers the declaration of a topic unless it was declared, the caller must hold the mutex.
+             * @param channel The topic ID.
+             * @param name The topic name.
+             * @param header Header of the declaration frame, its size is filled in.
+             */
+            void declare(std::uint32_t channel, const std::string& name, Header header) {
+                if (channel < declared_.size() && declared_[channel]) {
+                    return;
+                }
+                if (declared_.size() <= channel) {
+                    declared_.resize(channel + 1);
+                }
+                declared_[channel] = true;
+                auto* out = append(header, sizeof(channel) + name.size());
+                std::memcpy(out, &channel, sizeof(channel));
+                std::memcpy(out + sizeof(channel), name.data(), name.size());
+            }
+
+            /**
+             * @brief Applies the overflow policy until a frame fits the buffer, the caller must hold the mutex.
+             * @param lock The held lock.
+             * @param bytes Size of the frame.
+             * @return The result to report, or nothing once the frame fits.
+             */
+            std::optional<enqueue_result> reserve(std::unique_lock<std::mutex>& lock, std::size_t bytes) {
+                auto fits = [this, bytes] { return failed_ || bytes_.empty() || bytes_.size() + bytes <= max_bytes_; };
+                if (!fits()) {
+                    switch (policy_) {
+                        case overflow_policy::drop_newest:
+                            dropped_.fetch_add(1, std::memory_order_relaxed);
+                            return enqueue_result::dropped;
+                        case overflow_policy::fail:
+                            return enqueue_result::rejected;
+                        default:
+                            // A declaration may be buffered without a wakeup, so the writer must look before we wait.
+                            ready_.notify_one();
+                            space_.wait(lock, fits);
+                    }
+                }
+                if (failed_) {
+                    return enqueue_result::rejected;
+                }
+                return std::nullopt;
+            }
+
+            /**
+             * @brief Appends a frame header and returns where its payload goes, the caller must hold the mutex.
+             * @param header The header, its size is filled in.
+             * @param size Size of the payload.
+             * @return The payload position.
+             */
+            std::byte* append(Header header, std::size_t size) {
+                header.size_ = static_cast<std::uint32_t>(size);
+                auto offset = bytes_.size();
+                bytes_.resize(offset + sizeof(header) + size);
+                std::memcpy(bytes_.data() + offset, &header, sizeof(header));
+                return bytes_.data() + offset + sizeof(header);
+            }
+
+            /**
+             * @brief Hands the buffered frames to the writer thread and releases the lock.
+             * @param lock The held lock, unlocked on return.
+             * @param batch The empty buffer of the writer, swapped with the pending one.
+             */
+            void take(std::unique_lock<std::mutex>& lock, std::vector<std::byte>& batch) {
+                // Both buffers keep their capacity, so steady traffic does not allocate.
+                batch.swap(bytes_);
+                writing_ = true;
+                lock.unlock();
+                space_.notify_all();
+            }
+
+            /**
+             * @brief Takes the lock back once a batch is written and wakes waiting producers.
+             * @param lock The released lock, locked on return.
+             * @param ok Whether the batch was written.
+             */
+            void written(std::unique_lock<std::mutex>& lock, bool ok) {
+                lock.lock();
+                writing_ = false;
+                failed_ = failed_ || !ok;
+                space_.notify_all();
+            }
+
+            /**
+             * @brief Stops the writer thread once the buffer is empty.
+             */
+            void stop() {
+                {
+                    std::unique_lock lock(mutex_);
+                    stopping_ = true;
+                }
+                ready_.notify_one();
+            }
+
+            std::size_t max_bytes_; ///< Bytes buffered before the overflow policy applies.
+            overflow_policy policy_; ///< Behavior of a producer with a full buffer.
+            mutable std::mutex mutex_; ///< Guards the buffer and the writer state.
+            std::condition_variable ready_; ///< Signals the writer thread.
+            std::condition_variable space_; ///< Signals producers waiting for buffer space and flushes.
+            std::vector<std::byte> bytes_; ///< Encoded frames not yet handed to the writer thread.
+            std::vector<bool> declared_; ///< Topic IDs already declared.
+            bool writing_ = false; ///< Whether the writer thread is writing a batch.
+            bool stopping_ = false; ///< Stops the writer thread once the buffer is empty.
+            bool failed_ = false; ///< Set when writing a batch failed.
+            std::atomic<std::size_t> dropped_{0}; ///< Events dropped on a full buffer.
+        };
+    }
+}
+
+#endif //MICROBUS_MICROBUS_WIRE_HPP